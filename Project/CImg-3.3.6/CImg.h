@@ -329,6 +329,29 @@ enum {FALSE_WIN = 0};
 #define cimg_pragma_openmp(p)
 #endif
 
+// Configure the SIMD width of the edge-function triangle rasterizer.
+//
+// Define 'cimg_edge_lanes' to the number of pixels tested at once (16=AVX-512, 8=AVX2, 4=SSE2,
+// 1=scalar), or to 0 to shade all triangles with the older scanline loops.
+// By default, the widest instruction set enabled at compile time is used.
+// Either way, every filled triangle covers the same pixels: those whose center passes the three
+// edge functions, with the top-left rule for shared edges. Only triangles with a coordinate beyond
+// +-2^28 keep the row ends of the scanline loops.
+#ifndef cimg_edge_lanes
+#if defined(__AVX512F__)
+#define cimg_edge_lanes 16
+#elif defined(__AVX2__)
+#define cimg_edge_lanes 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define cimg_edge_lanes 4
+#else
+#define cimg_edge_lanes 1
+#endif
+#endif
+#if cimg_edge_lanes>1 || defined(__SSSE3__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
 // Configure the 'abort' signal handler (does nothing by default).
 // A typical signal handler can be defined in your own source like this:
 // #define cimg_abort_test if (is_abort) throw CImgAbortException("")
@@ -2491,6 +2514,14 @@ namespace cimg_library_suffixed {
 #ifndef cimg_openmp_sizefactor
 #define cimg_openmp_sizefactor 1
 #endif
+// Height of the bands of rows that draw_object3d() rasterizes in parallel (0 = never).
+#ifndef cimg_object3d_tile_height
+#define cimg_object3d_tile_height 32
+#endif
+// Size of the square tiles whose depth bounds let draw_object3d() skip hidden primitives (0 = never).
+#ifndef cimg_object3d_hiz_tile
+#define cimg_object3d_hiz_tile 8
+#endif
 #define cimg_openmp_if(cond) if ((cimg::openmp_mode()==1 || (cimg::openmp_mode()>1 && (cond))))
 #define cimg_openmp_if_size(size,min_size) cimg_openmp_if((size)>=(cimg_openmp_sizefactor)*(min_size))
 #ifdef _MSC_VER
@@ -36122,6 +36153,112 @@ namespace cimg_library_suffixed {
       return res;
     }
 
+    //! Write the first three channels as interleaved triplets (RGBRGB...) into a buffer.
+    /**
+       \param[out] ptrd Destination buffer, of at least 3*width()*height()*depth() values.
+       \note Gives the same values as <tt>get_shared_channels(0,2).get_permute_axes("cxyz")</tt>, but
+       writes straight into the buffer (e.g. one handed to a graphics API) with no intermediate image.
+       For 8-bit types, 32 (AVX2) or 16 (SSSE3) pixels are interleaved at once with byte shuffles.
+    **/
+    const CImg<T>& interleave_rgb(T *const ptrd) const {
+      if (is_empty()) return *this;
+      if (_spectrum<3)
+        throw CImgInstanceException(_cimg_instance
+                                    "interleave_rgb(): Instance has less than 3 channels.",
+                                    cimg_instance);
+      const ulongT whd = (ulongT)_width*_height*_depth;
+      const T *ptr_r = data(0,0,0,0), *ptr_g = data(0,0,0,1), *ptr_b = data(0,0,0,2);
+      T *ptr_d = ptrd;
+      ulongT n = whd;
+      if (sizeof(T)==1) {
+        const unsigned char
+          *const r = (const unsigned char*)ptr_r,
+          *const g = (const unsigned char*)ptr_g,
+          *const b = (const unsigned char*)ptr_b;
+        const ulongT done = _interleave_rgb8(r,g,b,(unsigned char*)ptrd,whd);
+        ptr_r+=done; ptr_g+=done; ptr_b+=done; ptr_d+=3*done; n-=done;
+      }
+      for (ulongT i = 0; i<n; ++i) {
+        *(ptr_d++) = *(ptr_r++);
+        *(ptr_d++) = *(ptr_g++);
+        *(ptr_d++) = *(ptr_b++);
+      }
+      return *this;
+    }
+
+    //! Interleave the first three channels \newinstance.
+    /**
+       \return An image of size (3,width(),height(),depth()), whose buffer holds the interleaved triplets.
+    **/
+    CImg<T> get_interleaved_rgb() const {
+      if (is_empty()) return CImg<T>();
+      CImg<T> res(3,_width,_height,_depth);
+      interleave_rgb(res._data);
+      return res;
+    }
+
+    // Interleave as many 8-bit pixels as whole SIMD blocks allow, return their number.
+    // Output byte k is channel k%3 of pixel k/3: each 16-byte output block shuffles bytes from
+    // all three channel blocks and ORs them (pshufb writes 0 where the index is negative).
+    static ulongT _interleave_rgb8(const unsigned char *const r, const unsigned char *const g,
+                                   const unsigned char *const b, unsigned char *const d, const ulongT n) {
+      ulongT i = 0;
+#if defined(__SSSE3__) || defined(__AVX__)
+      const __m128i
+        r0 = _mm_setr_epi8(0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1,5),
+        g0 = _mm_setr_epi8(-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1),
+        b0 = _mm_setr_epi8(-1,-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1),
+        r1 = _mm_setr_epi8(-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10,-1),
+        g1 = _mm_setr_epi8(5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10),
+        b1 = _mm_setr_epi8(-1,5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1),
+        r2 = _mm_setr_epi8(-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1),
+        g2 = _mm_setr_epi8(-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1),
+        b2 = _mm_setr_epi8(10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15);
+#if defined(__AVX2__)
+      // Shuffles stay within 128-bit lanes: each lane makes the 48 bytes of its own 16 pixels,
+      // which are then put back in order across the two lanes.
+      const __m256i
+        R0 = _mm256_broadcastsi128_si256(r0), G0 = _mm256_broadcastsi128_si256(g0),
+        B0 = _mm256_broadcastsi128_si256(b0), R1 = _mm256_broadcastsi128_si256(r1),
+        G1 = _mm256_broadcastsi128_si256(g1), B1 = _mm256_broadcastsi128_si256(b1),
+        R2 = _mm256_broadcastsi128_si256(r2), G2 = _mm256_broadcastsi128_si256(g2),
+        B2 = _mm256_broadcastsi128_si256(b2);
+      for ( ; i + 32<=n; i+=32) {
+        const __m256i
+          vr = _mm256_loadu_si256((const __m256i*)(r + i)),
+          vg = _mm256_loadu_si256((const __m256i*)(g + i)),
+          vb = _mm256_loadu_si256((const __m256i*)(b + i)),
+          o0 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(vr,R0),_mm256_shuffle_epi8(vg,G0)),
+                               _mm256_shuffle_epi8(vb,B0)),
+          o1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(vr,R1),_mm256_shuffle_epi8(vg,G1)),
+                               _mm256_shuffle_epi8(vb,B1)),
+          o2 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(vr,R2),_mm256_shuffle_epi8(vg,G2)),
+                               _mm256_shuffle_epi8(vb,B2));
+        __m256i *const pd = (__m256i*)(d + 3*i);
+        _mm256_storeu_si256(pd,_mm256_permute2x128_si256(o0,o1,0x20));
+        _mm256_storeu_si256(pd + 1,_mm256_permute2x128_si256(o2,o0,0x30));
+        _mm256_storeu_si256(pd + 2,_mm256_permute2x128_si256(o1,o2,0x31));
+      }
+#endif
+      for ( ; i + 16<=n; i+=16) {
+        const __m128i
+          vr = _mm_loadu_si128((const __m128i*)(r + i)),
+          vg = _mm_loadu_si128((const __m128i*)(g + i)),
+          vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i *const pd = (__m128i*)(d + 3*i);
+        _mm_storeu_si128(pd,_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr,r0),_mm_shuffle_epi8(vg,g0)),
+                                         _mm_shuffle_epi8(vb,b0)));
+        _mm_storeu_si128(pd + 1,_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr,r1),_mm_shuffle_epi8(vg,g1)),
+                                             _mm_shuffle_epi8(vb,b1)));
+        _mm_storeu_si128(pd + 2,_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr,r2),_mm_shuffle_epi8(vg,g2)),
+                                             _mm_shuffle_epi8(vb,b2)));
+      }
+#else
+      cimg::unused(r,g,b,d,n);
+#endif
+      return i;
+    }
+
     //! Unroll pixel values along specified axis.
     /**
        \param axis Unroll axis (can be \c 'x', \c 'y', \c 'z' or c 'c').
@@ -47239,6 +47376,336 @@ namespace cimg_library_suffixed {
       return draw_spline(points,tangents,color,opacity,is_closed_set,precision,pattern,init_hatch);
     }
 
+    // [internal] Depth test of a block of _draw_triangle_edges(): among the lanes set in 'mask', keep those
+    // whose inverse depth in 'izs' is not less than the z-buffer's, store their depths and return their mask.
+    template<typename tz>
+    static unsigned int _draw_triangle_depth(tz *const ptrz, const float *const izs, const unsigned int mask) {
+      unsigned int pass = 0;
+      for (int k = 0; k<cimg_edge_lanes; ++k) if ((mask>>k)&1 && !(izs[k]<ptrz[k])) {
+          ptrz[k] = (tz)izs[k];
+          pass|=1U<<k;
+        }
+      return pass;
+    }
+
+#if cimg_edge_lanes==16 || cimg_edge_lanes==8
+    // Float z-buffers use masked loads and stores, so lanes outside 'mask' are never accessed.
+    static unsigned int _draw_triangle_depth(float *const ptrz, const float *const izs, const unsigned int mask) {
+#if cimg_edge_lanes==16
+      const __m512 iz = _mm512_loadu_ps(izs);
+      const __mmask16 pass =
+        _mm512_mask_cmp_ps_mask((__mmask16)mask,iz,_mm512_maskz_loadu_ps((__mmask16)mask,ptrz),_CMP_NLT_UQ);
+      _mm512_mask_storeu_ps(ptrz,pass,iz);
+      return pass;
+#else
+      const __m256i
+        bits = _mm256_setr_epi32(1,2,4,8,16,32,64,128),
+        m = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)mask),bits),bits);
+      const __m256
+        iz = _mm256_loadu_ps(izs),
+        pass = _mm256_and_ps(_mm256_cmp_ps(iz,_mm256_maskload_ps(ptrz,m),_CMP_NLT_UQ),_mm256_castsi256_ps(m));
+      _mm256_maskstore_ps(ptrz,_mm256_castps_si256(pass),iz);
+      return (unsigned int)_mm256_movemask_ps(pass);
+#endif
+    }
+#endif
+
+    // [internal] Blend the shaded values 'vals' of a fully shaded block into one channel.
+    static void _draw_triangle_blend(T *const ptrd, const Tfloat *const vals,
+                                     const float opacity, const float nopacity, const float copacity) {
+      if (opacity>=1) for (int k = 0; k<cimg_edge_lanes; ++k) ptrd[k] = (T)vals[k]; // Vectorizable.
+      else for (int k = 0; k<cimg_edge_lanes; ++k) ptrd[k] = (T)(vals[k]*nopacity + ptrd[k]*copacity);
+    }
+
+    // [internal] Pixel shaders of _draw_triangle_edges().
+    // Each call shades the pixels of a block of consecutive lanes whose bits are set in 'mask'.
+    // Attributes are interpolated from the barycentric weights (w1s,w2s) of the second and third vertices,
+    // and blended with the brightness and opacity rules of the scanline rasterizer.
+    // A null 'zbuffer' disables depth testing.
+    template<typename tz, typename tc>
+    struct _draw_triangle_colored {
+      T *data; tz *zbuffer; const tc *color;
+      float iz0, diz1, diz2, bs0, dbs1, dbs2, opacity, nopacity, copacity;
+      ulongT whd; unsigned int spectrum; T maxval;
+
+      _draw_triangle_colored(CImg<T>& img, tz *const zbuf, const tc *const col, const float opac,
+                             const float z0, const float z1, const float z2,
+                             const float b0, const float b1, const float b2):
+        data(img._data),zbuffer(zbuf),color(col),iz0(z0),diz1(z1 - z0),diz2(z2 - z0),
+        bs0(b0),dbs1(b1 - b0),dbs2(b2 - b0),opacity(opac),
+        nopacity(cimg::abs(opac)),copacity(1 - std::max(opac,0.f)),
+        whd((ulongT)img._width*img._height*img._depth),spectrum(img._spectrum),
+        maxval((T)std::min(cimg::type<T>::max(),(T)cimg::type<tc>::max())) {}
+
+      void operator()(const ulongT off, unsigned int mask, const float *const w1s, const float *const w2s) const {
+        float izs[cimg_edge_lanes], bss[cimg_edge_lanes];
+        Tfloat vals[cimg_edge_lanes];
+        for (int k = 0; k<cimg_edge_lanes; ++k) { // Vectorizable.
+          izs[k] = iz0 + w1s[k]*diz1 + w2s[k]*diz2;
+          bss[k] = cimg::cut(bs0 + w1s[k]*dbs1 + w2s[k]*dbs2,0.f,2.f);
+        }
+        if (zbuffer && !(mask = _draw_triangle_depth(zbuffer + off,izs,mask))) return;
+        if (mask!=(1U<<cimg_edge_lanes) - 1) { // Partially shaded block: one lane at a time.
+          for (unsigned int k = 0; mask; mask>>=1, ++k) if (mask&1) {
+            const float cbs = bss[k];
+            T *const ptrd = data + off + k;
+            for (unsigned int c = 0; c<spectrum; ++c) {
+              const Tfloat val = cbs<=1?color[c]*cbs:(2 - cbs)*color[c] + (cbs - 1)*maxval;
+              ptrd[c*whd] = (T)(opacity>=1?val:val*nopacity + ptrd[c*whd]*copacity);
+            }
+          }
+          return;
+        }
+        for (unsigned int c = 0; c<spectrum; ++c) {
+          const tc col = color[c];
+          for (int k = 0; k<cimg_edge_lanes; ++k) { // Vectorizable.
+            const float cbs = bss[k];
+            vals[k] = cbs<=1?col*cbs:(2 - cbs)*col + (cbs - 1)*maxval;
+          }
+          _draw_triangle_blend(data + off + c*whd,vals,opacity,nopacity,copacity);
+        }
+      }
+    };
+
+    // Texture coordinates are premultiplied by the inverse depths when 'is_perspective' is set.
+    template<typename tz, typename tc>
+    struct _draw_triangle_textured {
+      T *data; tz *zbuffer; const tc *tdata;
+      float iz0, diz1, diz2, tx0, dtx1, dtx2, ty0, dty1, dty2, bs0, dbs1, dbs2, opacity, nopacity, copacity;
+      ulongT whd, twhd; int tw, tw1, th1; unsigned int spectrum; T maxval; bool is_perspective;
+
+      _draw_triangle_textured(CImg<T>& img, tz *const zbuf, const CImg<tc>& tex, const float opac,
+                              const bool perspective, const float z0, const float z1, const float z2,
+                              const float u0, const float v0, const float u1, const float v1,
+                              const float u2, const float v2,
+                              const float b0, const float b1, const float b2):
+        data(img._data),zbuffer(zbuf),tdata(tex._data),iz0(z0),diz1(z1 - z0),diz2(z2 - z0),
+        tx0(perspective?u0*z0:u0),dtx1((perspective?u1*z1:u1) - tx0),dtx2((perspective?u2*z2:u2) - tx0),
+        ty0(perspective?v0*z0:v0),dty1((perspective?v1*z1:v1) - ty0),dty2((perspective?v2*z2:v2) - ty0),
+        bs0(b0),dbs1(b1 - b0),dbs2(b2 - b0),opacity(opac),
+        nopacity(cimg::abs(opac)),copacity(1 - std::max(opac,0.f)),
+        whd((ulongT)img._width*img._height*img._depth),
+        twhd((ulongT)tex._width*tex._height*tex._depth),
+        tw(tex.width()),tw1(tex.width() - 1),th1(tex.height() - 1),spectrum(img._spectrum),
+        maxval((T)std::min(cimg::type<T>::max(),(T)cimg::type<tc>::max())),is_perspective(perspective) {}
+
+      void operator()(const ulongT off, unsigned int mask, const float *const w1s, const float *const w2s) const {
+        float izs[cimg_edge_lanes], txs[cimg_edge_lanes], tys[cimg_edge_lanes], bss[cimg_edge_lanes];
+        Tfloat vals[cimg_edge_lanes];
+        ulongT toffs[cimg_edge_lanes];
+        for (int k = 0; k<cimg_edge_lanes; ++k) { // Vectorizable.
+          izs[k] = iz0 + w1s[k]*diz1 + w2s[k]*diz2;
+          txs[k] = tx0 + w1s[k]*dtx1 + w2s[k]*dtx2;
+          tys[k] = ty0 + w1s[k]*dty1 + w2s[k]*dty2;
+          bss[k] = cimg::cut(bs0 + w1s[k]*dbs1 + w2s[k]*dbs2,0.f,2.f);
+        }
+        if (is_perspective) for (int k = 0; k<cimg_edge_lanes; ++k) { txs[k]/=izs[k]; tys[k]/=izs[k]; }
+        if (zbuffer && !(mask = _draw_triangle_depth(zbuffer + off,izs,mask))) return;
+        if (mask!=(1U<<cimg_edge_lanes) - 1) { // Partially shaded block: one lane at a time.
+          for (unsigned int k = 0; mask; mask>>=1, ++k) if (mask&1) {
+            const int
+              tx = (int)cimg::round(txs[k]),
+              ty = (int)cimg::round(tys[k]);
+            const tc *const color = tdata + cimg::cut(tx,0,tw1) + (ulongT)cimg::cut(ty,0,th1)*tw;
+            const float cbs = bss[k];
+            T *const ptrd = data + off + k;
+            for (unsigned int c = 0; c<spectrum; ++c) {
+              const tc col = color[c*twhd];
+              const Tfloat val = cbs<=1?cbs*col:(2 - cbs)*col + (cbs - 1)*maxval;
+              ptrd[c*whd] = (T)(opacity>=1?val:val*nopacity + ptrd[c*whd]*copacity);
+            }
+          }
+          return;
+        }
+
+        // Texel offsets of a full block, clamped to the texture as floats so that NaNs are safe.
+        for (int k = 0; k<cimg_edge_lanes; ++k) { // Vectorizable.
+          const int
+            cx = (int)std::min(std::max(0.f,cimg::round(txs[k])),(float)tw1),
+            cy = (int)std::min(std::max(0.f,cimg::round(tys[k])),(float)th1);
+          toffs[k] = cx + (ulongT)cy*tw;
+        }
+        for (unsigned int c = 0; c<spectrum; ++c) {
+          const tc *const tdatac = tdata + c*twhd;
+          for (int k = 0; k<cimg_edge_lanes; ++k) {
+            const tc col = tdatac[toffs[k]];
+            const float cbs = bss[k];
+            vals[k] = cbs<=1?cbs*col:(2 - cbs)*col + (cbs - 1)*maxval;
+          }
+          _draw_triangle_blend(data + off + c*whd,vals,opacity,nopacity,copacity);
+        }
+      }
+    };
+
+    // [internal] Pixels covered by a filled triangle, shared by every filled draw_triangle() variant
+    // so that they all agree on which pixels a triangle covers.
+    // Edge k is opposite vertex k, so its value at a pixel is the (unnormalized) weight of vertex k.
+    // Values are biased so that a pixel is covered when all three are non-negative, and pixel centers
+    // lying exactly on an edge follow the top-left rule: triangles that share an edge never draw the
+    // same pixel twice, and degenerate triangles draw nothing.
+    // The edge functions are exact for coordinates up to +-2^28. Beyond that, span() returns the row ends
+    // found by the scanline loops instead.
+    struct _draw_triangle_setup {
+      cimg_int64 A[3], B[3], C[3], area;
+      int b[3], xmin, xmax, ymin, ymax, w1;
+      bool is_exact;
+
+      _draw_triangle_setup(const CImg<T>& img,
+                           const int x0, const int y0,
+                           const int x1, const int y1,
+                           const int x2, const int y2) {
+        const int lim = 1<<28;
+        const cimg_int64 X0 = x0, Y0 = y0, X1 = x1, Y1 = y1, X2 = x2, Y2 = y2;
+        A[0] = Y1 - Y2; B[0] = X2 - X1; C[0] = X1*Y2 - X2*Y1;
+        A[1] = Y2 - Y0; B[1] = X0 - X2; C[1] = X2*Y0 - X0*Y2;
+        A[2] = Y0 - Y1; B[2] = X1 - X0; C[2] = X0*Y1 - X1*Y0;
+        area = C[0] + C[1] + C[2];
+        if (area<0) {
+          for (int k = 0; k<3; ++k) { A[k] = -A[k]; B[k] = -B[k]; C[k] = -C[k]; }
+          area = -area;
+        }
+        for (int k = 0; k<3; ++k) b[k] = A[k]>0 || (!A[k] && B[k]>0)?0:1;
+        w1 = img.width() - 1;
+        xmin = std::max(cimg::min(x0,x1,x2),0); xmax = std::min(cimg::max(x0,x1,x2),w1);
+        ymin = std::max(cimg::min(y0,y1,y2),0); ymax = std::min(cimg::max(y0,y1,y2),img.height() - 1);
+        is_exact =
+          cimg::abs(x0)<=lim && cimg::abs(y0)<=lim && cimg::abs(x1)<=lim && cimg::abs(y1)<=lim &&
+          cimg::abs(x2)<=lim && cimg::abs(y2)<=lim;
+      }
+
+      // Biased value of edge k at pixel (x,y).
+      cimg_int64 edge(const int k, const int x, const int y) const {
+        return A[k]*x + B[k]*y + C[k] - b[k];
+      }
+
+      // First and last pixels of row y covered by the triangle; false if there are none.
+      bool span(const int y, int& xs, int& xe) const {
+        if (!area || y<ymin || y>ymax) return false;
+        cimg_int64 s = xmin, e = xmax;
+        for (int k = 0; k<3; ++k) {
+          const cimg_int64 v = edge(k,xmin,y);
+          if (A[k]>0) { if (v<0) s = std::max(s,xmin + (A[k] - 1 - v)/A[k]); }
+          else if (v<0) return false;
+          else if (A[k]<0) e = std::min(e,xmin + v/-A[k]);
+        }
+        if (s>e) return false;
+        xs = (int)s; xe = (int)e;
+        return true;
+      }
+
+      // Same, for a scanline loop whose own row ends are 'xm' and 'xM'.
+      bool span(const int y, const cimg_int64 xm, const cimg_int64 xM, int& xs, int& xe) const {
+        if (is_exact) return span(y,xs,xe);
+        if (xM<0 || xm>w1) return false;
+        xs = (int)cimg::cut(xm,(cimg_int64)0,(cimg_int64)w1);
+        xe = (int)cimg::cut(xM,(cimg_int64)0,(cimg_int64)w1);
+        return true;
+      }
+    };
+
+    // [internal] Rasterize a triangle with half-space edge functions.
+    // The covered pixels of each row are shaded in blocks of 'cimg_edge_lanes' consecutive pixels
+    // (SSE2, AVX2 or AVX-512, or one pixel at a time): 'shader' is called once per block, with the
+    // offset of the block, its coverage mask and the barycentric weights of the second and third vertices.
+    // Return false (having drawn nothing) when the edge functions do not fit in 32 bits, so that the
+    // caller can fall back to its scanline loop, which still covers the pixels of 'tri'.
+    template<typename tf>
+    bool _draw_triangle_edges(const _draw_triangle_setup& tri, const tf& shader) {
+#if cimg_edge_lanes>0
+      if (!tri.is_exact) return false;
+      if (!tri.area) return true;
+      if (tri.area>(1<<29) || cimg::abs(tri.A[1])>(1<<20) || cimg::abs(tri.A[2])>(1<<20)) return false;
+
+      const int
+        N = cimg_edge_lanes,
+        A1 = (int)tri.A[1], A2 = (int)tri.A[2],
+        b1 = tri.b[1], b2 = tri.b[2];
+      const unsigned int full = (1U<<N) - 1;
+      const float iarea = 1.f/tri.area;
+      const tf sh(shader); // Local copy, so that its fields are not reloaded after each pixel write.
+      float w1s[cimg_edge_lanes], w2s[cimg_edge_lanes];
+
+#if cimg_edge_lanes==16
+      const __m512i
+        lane = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15),
+        dA1 = _mm512_mullo_epi32(lane,_mm512_set1_epi32(A1)),
+        dA2 = _mm512_mullo_epi32(lane,_mm512_set1_epi32(A2)),
+        sA1 = _mm512_set1_epi32(N*A1), sA2 = _mm512_set1_epi32(N*A2),
+        vb1 = _mm512_set1_epi32(b1), vb2 = _mm512_set1_epi32(b2);
+      const __m512 via = _mm512_set1_ps(iarea);
+#elif cimg_edge_lanes==8
+      const __m256i
+        dA1 = _mm256_setr_epi32(0,A1,2*A1,3*A1,4*A1,5*A1,6*A1,7*A1),
+        dA2 = _mm256_setr_epi32(0,A2,2*A2,3*A2,4*A2,5*A2,6*A2,7*A2),
+        sA1 = _mm256_set1_epi32(N*A1), sA2 = _mm256_set1_epi32(N*A2),
+        vb1 = _mm256_set1_epi32(b1), vb2 = _mm256_set1_epi32(b2);
+      const __m256 via = _mm256_set1_ps(iarea);
+#elif cimg_edge_lanes==4
+      const __m128i
+        dA1 = _mm_setr_epi32(0,A1,2*A1,3*A1),
+        dA2 = _mm_setr_epi32(0,A2,2*A2,3*A2),
+        sA1 = _mm_set1_epi32(N*A1), sA2 = _mm_set1_epi32(N*A2),
+        vb1 = _mm_set1_epi32(b1), vb2 = _mm_set1_epi32(b2);
+      const __m128 via = _mm_set1_ps(iarea);
+#endif
+
+      for (int y = tri.ymin; y<=tri.ymax; ++y) {
+        int xs, xe;
+        if (!tri.span(y,xs,xe)) continue;
+        int
+          e1 = (int)tri.edge(1,xs,y),
+          e2 = (int)tri.edge(2,xs,y);
+        ulongT off = (ulongT)y*_width + xs;
+
+#if cimg_edge_lanes==16
+        __m512i
+          E1 = _mm512_add_epi32(_mm512_set1_epi32(e1),dA1),
+          E2 = _mm512_add_epi32(_mm512_set1_epi32(e2),dA2);
+#elif cimg_edge_lanes==8
+        __m256i
+          E1 = _mm256_add_epi32(_mm256_set1_epi32(e1),dA1),
+          E2 = _mm256_add_epi32(_mm256_set1_epi32(e2),dA2);
+#elif cimg_edge_lanes==4
+        __m128i
+          E1 = _mm_add_epi32(_mm_set1_epi32(e1),dA1),
+          E2 = _mm_add_epi32(_mm_set1_epi32(e2),dA2);
+#endif
+        for (int x = xs; x<=xe; x+=N) {
+#if cimg_edge_lanes==16
+          // GCC 12 reports the undefined pass-through operand of _mm512_cvtepi32_ps() as uninitialized.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+          _mm512_storeu_ps(w1s,_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_add_epi32(E1,vb1)),via));
+          _mm512_storeu_ps(w2s,_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_add_epi32(E2,vb2)),via));
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+          E1 = _mm512_add_epi32(E1,sA1); E2 = _mm512_add_epi32(E2,sA2);
+#elif cimg_edge_lanes==8
+          _mm256_storeu_ps(w1s,_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(E1,vb1)),via));
+          _mm256_storeu_ps(w2s,_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(E2,vb2)),via));
+          E1 = _mm256_add_epi32(E1,sA1); E2 = _mm256_add_epi32(E2,sA2);
+#elif cimg_edge_lanes==4
+          _mm_storeu_ps(w1s,_mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(E1,vb1)),via));
+          _mm_storeu_ps(w2s,_mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(E2,vb2)),via));
+          E1 = _mm_add_epi32(E1,sA1); E2 = _mm_add_epi32(E2,sA2);
+#else
+          w1s[0] = (e1 + b1)*iarea; w2s[0] = (e2 + b2)*iarea;
+          e1+=A1; e2+=A2;
+#endif
+          sh(off,x + N - 1>xe?(1U<<(xe - x + 1)) - 1:full,w1s,w2s);
+          off+=N;
+        }
+      }
+      return true;
+#else
+      cimg::unused(tri); cimg::unused(shader);
+      return false;
+#endif
+    }
+
     // [internal] Draw a filled triangle.
     template<typename tc>
     CImg<T>& _draw_triangle(int x0, int y0,
@@ -47250,6 +47717,7 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
       const int
         h1 = height() - 1,
@@ -47269,7 +47737,8 @@ namespace cimg_library_suffixed {
           xm = y<y1?x0 + (dx01*yy0 + hdy01)/dy01:x1 + (dx12*yy1 + hdy12)/dy12,
           xM = x0 + (dx02*yy0 + hdy02)/dy02;
         if (xm>xM) cimg::swap(xm,xM);
-        cimg_draw_scanline(xm,xM,y,color,opacity,cbs);
+        int xs, xe;
+        if (tri.span(y,xm,xM,xs,xe)) cimg_draw_scanline(xs,xe,y,color,opacity,cbs);
       }
       return *this;
     }
@@ -47368,8 +47837,13 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_colored<tz,tc>(*this,zbuffer._data,color,opacity,iz0,iz1,iz2,
+                                                             brightness,brightness,brightness)))
+        return *this;
 
-      const int w1 = width() - 1, h1 = height() - 1, cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1);
+      const int h1 = height() - 1, cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1);
       const longT
         dx01 = (longT)x1 - x0, dx02 = (longT)x2 - x0, dx12 = (longT)x2 - x1,
         dy01 = std::max((longT)1,(longT)y1 - y0),
@@ -47390,17 +47864,15 @@ namespace cimg_library_suffixed {
           izm = y<y1?(iz0 + diz01*yy0/dy01):(iz1 + diz12*yy1/dy12),
           izM = iz0 + diz02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,izm,izM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = (int)cimg::cut(xm,(longT)0,(longT)w1),
-            cxM = (int)cimg::cut(xM,(longT)0,(longT)w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           tz *ptrz = zbuffer.data(cxm,y);
           const longT dxmM = std::max((longT)1,xM - xm);
           const float dizmM = izM - izm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const longT xxm = x - xm;
+            const longT xxm = cimg::cut(x - xm,(longT)0,dxmM);
             const float iz = izm + dizmM*xxm/dxmM;
             if (iz>=*ptrz) {
               *ptrz = (tz)iz;
@@ -47449,8 +47921,12 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,bs0,bs2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,bs1,bs2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_colored<float,tc>(*this,(float*)0,color,opacity,0,0,0,bs0,bs1,bs2)))
+        return *this;
 
-      const int w1 = width() - 1, h1 = height() - 1, cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1);
+      const int h1 = height() - 1, cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1);
       const longT
         dx01 = (longT)x1 - x0, dx02 = (longT)x2 - x0, dx12 = (longT)x2 - x1,
         dy01 = std::max((longT)1,(longT)y1 - y0),
@@ -47470,16 +47946,14 @@ namespace cimg_library_suffixed {
           bsm = y<y1?(bs0 + dbs01*yy0/dy01):(bs1 + dbs12*yy1/dy12),
           bsM = bs0 + dbs02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,bsm,bsM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = (int)cimg::cut(xm,(longT)0,(longT)w1),
-            cxM = (int)cimg::cut(xM,(longT)0,(longT)w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const longT dxmM = std::max((longT)1,xM - xm);
           const float dbsmM = bsM - bsm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const longT xxm = (longT)x - xm;
+            const longT xxm = cimg::cut((longT)x - xm,(longT)0,dxmM);
             const float cbs = cimg::cut(bsm + dbsmM*xxm/dxmM,0,2);
             cimg_forC(*this,c) {
               const Tfloat val = cbs<=1?color[c]*cbs:(2 - cbs)*color[c] + (cbs - 1)*_sc_maxval;
@@ -47520,9 +47994,13 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,bs0,bs2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,bs1,bs2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_colored<tz,tc>(*this,zbuffer._data,color,opacity,iz0,iz1,iz2,bs0,bs1,bs2)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -47544,17 +48022,15 @@ namespace cimg_library_suffixed {
           bsm = y<y1?(bs0 + dbs01*yy0/dy01):(bs1 + dbs12*yy1/dy12),
           bsM = bs0 + dbs02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,izm,izM,bsm,bsM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           tz *ptrz = zbuffer.data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
           const float dizmM = izM - izm, dbsmM = bsM - bsm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float iz = izm + dizmM*xxm/dxmM;
             if (iz>=*ptrz) {
               *ptrz = (tz)iz;
@@ -47603,8 +48079,9 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,color0,color2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,color1,color2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
-      const int w1 = width() - 1, h1 = height() - 1, cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1);
+      const int h1 = height() - 1, cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1);
       const longT
         dx01 = (longT)x1 - x0, dx02 = (longT)x2 - x0, dx12 = (longT)x2 - x1,
         dy01 = std::max((longT)1,(longT)y1 - y0),
@@ -47625,16 +48102,14 @@ namespace cimg_library_suffixed {
             colorm = y<y1?(color0[c] + dcolor01*yy0/dy01):(color1[c] + dcolor12*yy1/dy12),
             colorM = color0[c] + dcolor02*yy0/dy02;
           if (xm>xM) cimg::swap(xm,xM,colorm,colorM);
-          if (xM>=0 && xm<=w1) {
-            const int
-              cxm = (int)cimg::cut(xm,(longT)0,(longT)w1),
-              cxM = (int)cimg::cut(xM,(longT)0,(longT)w1);
+          int cxm, cxM;
+          if (tri.span(y,xm,xM,cxm,cxM)) {
             T *ptrd = data(cxm,y);
             const longT dxmM = std::max((longT)1,xM - xm);
             const stc dcolormM = colorM - colorm;
 
             for (int x = cxm; x<=cxM; ++x) {
-              const longT xxm = (longT)x - xm;
+              const longT xxm = cimg::cut((longT)x - xm,(longT)0,dxmM);
               const stc col = colorm + dcolormM*xxm/dxmM;
               ptrd[c*_sc_whd] = (T)(opacity>=1?col:col*_sc_nopacity + ptrd[c*_sc_whd]*_sc_copacity);
               ++ptrd;
@@ -47686,9 +48161,15 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,tx0,tx2,ty0,ty2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,tx1,ty1,tx2,ty2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_textured<float,tc>(*this,(float*)0,texture,opacity,false,0,0,0,
+                                                                 tx0,ty0,tx1,ty1,tx2,ty2,
+                                                                 brightness,brightness,brightness)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -47711,10 +48192,8 @@ namespace cimg_library_suffixed {
           tym = y<y1?ty0 + (dty01*yy0 + hdy01ty)/dy01:ty1 + (dty12*yy1 + hdy12ty)/dy12,
           tyM = ty0 + (dty02*yy0 + hdy02ty)/dy02;
         if (xm>xM) cimg::swap(xm,xM,txm,txM,tym,tyM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int
             dxmM = std::max(1,xM - xm), hdxmM = dxmM/2,
@@ -47722,7 +48201,7 @@ namespace cimg_library_suffixed {
 
           for (int x = cxm; x<=cxM; ++x) {
             const int
-              xxm = x - xm,
+              xxm = cimg::cut(x - xm,0,dxmM),
               tx = (txm*dxmM + dtxmM*xxm + hdxmM)/dxmM,
               ty = (tym*dxmM + dtymM*xxm + hdxmM)/dxmM;
             const tc *const color = &texture._atXY(tx,ty);
@@ -47762,9 +48241,15 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,tx0,tx2,ty0,ty2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,tx1,tx2,ty1,ty2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_textured<float,tc>(*this,(float*)0,texture,opacity,true,iz0,iz1,iz2,
+                                                                 tx0,ty0,tx1,ty1,tx2,ty2,
+                                                                 brightness,brightness,brightness)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -47793,16 +48278,14 @@ namespace cimg_library_suffixed {
           tyzm = y<y1?(tyz0 + dtyz01*yy0/dy01):(tyz1 + dtyz12*yy1/dy12),
           tyzM = tyz0 + dtyz02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,txzm,txzM,tyzm,tyzM,izm,izM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
           const float dizmM = izM - izm, dtxzmM = txzM - txzm, dtyzmM = tyzM - tyzm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float
               iz = izm + dizmM*xxm/dxmM,
               txz = txzm + dtxzmM*xxm/dxmM,
@@ -47855,9 +48338,15 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,tx0,tx2,ty0,ty2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,tx1,tx2,ty1,ty2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_textured<tz,tc>(*this,zbuffer._data,texture,opacity,true,iz0,iz1,iz2,
+                                                              tx0,ty0,tx1,ty1,tx2,ty2,
+                                                              brightness,brightness,brightness)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -47886,17 +48375,15 @@ namespace cimg_library_suffixed {
           tyzm = y<y1?(tyz0 + dtyz01*yy0/dy01):(tyz1 + dtyz12*yy1/dy12),
           tyzM = tyz0 + dtyz02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,txzm,txzM,tyzm,tyzM,izm,izM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           tz *ptrz = zbuffer.data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
           const float dizmM = izM - izm, dtxzmM = txzM - txzm, dtyzmM = tyzM - tyzm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float iz = izm + dizmM*xxm/dxmM;
             if (iz>=*ptrz) {
               *ptrz = (tz)iz;
@@ -47961,9 +48448,10 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,lx0,lx2,ly0,ly2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,lx1,lx2,ly1,ly2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -47986,10 +48474,8 @@ namespace cimg_library_suffixed {
           lym = y<y1?ly0 + (dly01*yy0 + hdy01ly)/dy01:ly1 + (dly12*yy1 + hdy12ly)/dy12,
           lyM = ly0 + (dly02*yy0 + hdy02ly)/dy02;
         if (xm>xM) cimg::swap(xm,xM,lxm,lxM,lym,lyM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int
             dxmM = std::max(1,xM - xm), hdxmM = dxmM/2,
@@ -47997,7 +48483,7 @@ namespace cimg_library_suffixed {
 
           for (int x = cxm; x<=cxM; ++x) {
             const int
-              xxm = x - xm,
+              xxm = cimg::cut(x - xm,0,dxmM),
               lx = (lxm*dxmM + dlxmM*xxm + hdxmM)/dxmM,
               ly = (lym*dxmM + dlymM*xxm + hdxmM)/dxmM;
             const tl *const lig = &light._atXY(lx,ly);
@@ -48049,9 +48535,10 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,lx0,lx2,ly0,ly2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,lx1,lx2,ly1,ly2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48079,10 +48566,8 @@ namespace cimg_library_suffixed {
           izM = iz0 + diz02*yy0/dy02;
 
         if (xm>xM) cimg::swap(xm,xM,lxm,lxM,lym,lyM,izm,izM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           tz *ptrz = zbuffer.data(cxm,y);
           const int
@@ -48091,7 +48576,7 @@ namespace cimg_library_suffixed {
           const float dizmM = izM - izm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float iz = izm + dizmM*xxm/dxmM;
             if (iz>=*ptrz) {
               *ptrz = (tz)iz;
@@ -48159,9 +48644,14 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,tx0,tx2,ty0,ty2,bs0,bs2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,tx1,tx2,ty1,ty2,bs1,bs2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_textured<float,tc>(*this,(float*)0,texture,opacity,false,0,0,0,
+                                                                 tx0,ty0,tx1,ty1,tx2,ty2,bs0,bs1,bs2)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48188,10 +48678,8 @@ namespace cimg_library_suffixed {
           bsm = y<y1?(bs0 + dbs01*yy0/dy01):(bs1 + dbs12*yy1/dy12),
           bsM = bs0 + dbs02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,txm,txM,tym,tyM,bsm,bsM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int
             dxmM = std::max(1,xM - xm), hdxmM = dxmM/2,
@@ -48200,7 +48688,7 @@ namespace cimg_library_suffixed {
 
           for (int x = cxm; x<=cxM; ++x) {
             const int
-              xxm = x - xm,
+              xxm = cimg::cut(x - xm,0,dxmM),
               tx = (txm*dxmM + dtxmM*xxm + hdxmM)/dxmM,
               ty = (tym*dxmM + dtymM*xxm + hdxmM)/dxmM;
             const float cbs = cimg::cut(bsm + dbsmM*xxm/dxmM,0,2);
@@ -48244,9 +48732,14 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,tx0,tx2,ty0,ty2,bs0,bs2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,tx1,tx2,ty1,ty2,bs1,bs2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_textured<float,tc>(*this,(float*)0,texture,opacity,true,iz0,iz1,iz2,
+                                                                 tx0,ty0,tx1,ty1,tx2,ty2,bs0,bs1,bs2)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48277,16 +48770,14 @@ namespace cimg_library_suffixed {
           bsm = y<y1?(bs0 + dbs01*yy0/dy01):(bs1 + dbs12*yy1/dy12),
           bsM = bs0 + dbs02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,txzm,txzM,tyzm,tyzM,izm,izM,bsm,bsM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
           const float dizmM = izM - izm, dtxzmM = txzM - txzm, dtyzmM = tyzM - tyzm, dbsmM = bsM - bsm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float
               iz = izm + dizmM*xxm/dxmM,
               txz = txzm + dtxzmM*xxm/dxmM,
@@ -48342,9 +48833,14 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,tx0,tx2,ty0,ty2,bs0,bs2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,tx1,tx2,ty1,ty2,bs1,bs2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
+      if (_draw_triangle_edges(tri,
+                               _draw_triangle_textured<tz,tc>(*this,zbuffer._data,texture,opacity,true,iz0,iz1,iz2,
+                                                              tx0,ty0,tx1,ty1,tx2,ty2,bs0,bs1,bs2)))
+        return *this;
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48375,17 +48871,15 @@ namespace cimg_library_suffixed {
           bsm = y<y1?(bs0 + dbs01*yy0/dy01):(bs1 + dbs12*yy1/dy12),
           bsM = bs0 + dbs02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,txzm,txzM,tyzm,tyzM,izm,izM,bsm,bsM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           tz *ptrz = zbuffer.data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
           const float dizmM = izM - izm, dtxzmM = txzM - txzm, dtyzmM = tyzM - tyzm, dbsmM = bsM - bsm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float iz = izm + dizmM*xxm/dxmM;
             if (iz>=*ptrz) {
               *ptrz = (tz)iz;
@@ -48466,9 +48960,10 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,tx0,tx2,ty0,ty2,lx0,lx2,ly0,ly2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,tx1,tx2,ty1,ty2,lx1,lx2,ly1,ly2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48501,10 +48996,8 @@ namespace cimg_library_suffixed {
           lym = y<y1?ly0 + (dly01*yy0 + hdy01ly)/dy01:ly1 + (dly12*yy1 + hdy12ly)/dy12,
           lyM = ly0 + (dly02*yy0 + hdy02ly)/dy02;
         if (xm>xM) cimg::swap(xm,xM,txm,txM,tym,tyM,lxm,lxM,lym,lyM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int
             dxmM = std::max(1,xM - xm), hdxmM = dxmM/2,
@@ -48513,7 +49006,7 @@ namespace cimg_library_suffixed {
 
           for (int x = cxm; x<=cxM; ++x) {
             const int
-              xxm = x - xm,
+              xxm = cimg::cut(x - xm,0,dxmM),
               tx = (txm*dxmM + dtxmM*xxm + hdxmM)/dxmM,
               ty = (tym*dxmM + dtymM*xxm + hdxmM)/dxmM,
               lx = (lxm*dxmM + dlxmM*xxm + hdxmM)/dxmM,
@@ -48569,9 +49062,10 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,tx0,tx2,ty0,ty2,lx0,lx2,ly0,ly2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,tx1,tx2,ty1,ty2,lx1,lx2,ly1,ly2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48609,10 +49103,8 @@ namespace cimg_library_suffixed {
           lyzm = y<y1?(lyz0 + dlyz01*yy0/dy01):(lyz1 + dlyz12*yy1/dy12),
           lyzM = lyz0 + dlyz02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,izm,izM,txzm,txzM,tyzm,tyzM,lxzm,lxzM,lyzm,lyzM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
           const float
@@ -48621,7 +49113,7 @@ namespace cimg_library_suffixed {
             dlxzmM = lxzM - lxzm, dlyzmM = lyzM - lyzm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float
               iz = izm + dizmM*xxm/dxmM,
               txz = txzm + dtxzmM*xxm/dxmM,
@@ -48691,9 +49183,10 @@ namespace cimg_library_suffixed {
       if (y0>y2) cimg::swap(x0,x2,y0,y2,iz0,iz2,tx0,tx2,ty0,ty2,lx0,lx2,ly0,ly2);
       if (y1>y2) cimg::swap(x1,x2,y1,y2,iz1,iz2,tx1,tx2,ty1,ty2,lx1,lx2,ly1,ly2);
       if (y2<0 || y0>=height() || cimg::min(x0,x1,x2)>=width() || cimg::max(x0,x1,x2)<0 || !opacity) return *this;
+      const _draw_triangle_setup tri(*this,x0,y0,x1,y1,x2,y2);
 
       const int
-        w1 = width() - 1, h1 = height() - 1,
+        h1 = height() - 1,
         dx01 = x1 - x0, dx02 = x2 - x0, dx12 = x2 - x1,
         dy01 = std::max(1,y1 - y0), dy02 = std::max(1,y2 - y0), dy12 = std::max(1,y2 - y1),
         cy0 = cimg::cut(y0,0,h1), cy2 = cimg::cut(y2,0,h1),
@@ -48731,10 +49224,8 @@ namespace cimg_library_suffixed {
           lyzm = y<y1?(lyz0 + dlyz01*yy0/dy01):(lyz1 + dlyz12*yy1/dy12),
           lyzM = lyz0 + dlyz02*yy0/dy02;
         if (xm>xM) cimg::swap(xm,xM,izm,izM,txzm,txzM,tyzm,tyzM,lxzm,lxzM,lyzm,lyzM);
-        if (xM>=0 && xm<=w1) {
-          const int
-            cxm = cimg::cut(xm,0,w1),
-            cxM = cimg::cut(xM,0,w1);
+        int cxm, cxM;
+        if (tri.span(y,xm,xM,cxm,cxM)) {
           T *ptrd = data(cxm,y);
           tz *ptrz = zbuffer.data(cxm,y);
           const int dxmM = std::max(1,xM - xm);
@@ -48744,7 +49235,7 @@ namespace cimg_library_suffixed {
             dlxzmM = lxzM - lxzm, dlyzmM = lyzM - lyzm;
 
           for (int x = cxm; x<=cxM; ++x) {
-            const int xxm = x - xm;
+            const int xxm = cimg::cut(x - xm,0,dxmM);
             const float iz = izm + dizmM*xxm/dxmM;
             if (iz>=*ptrz) {
               *ptrz = (tz)iz;
@@ -51206,13 +51697,173 @@ namespace cimg_library_suffixed {
       } break;
       }
 
-      // Draw visible primitives
+      // Draw visible primitives.
+      // With OpenMP, large objects are drawn in bands of rows: visible triangles and quadrangles
+      // are binned by the rows they cover, and each band is rasterized on its own thread into its
+      // (shared) rows of the image and of the z-buffer. Rows of a multi-channel image are not
+      // contiguous, so such bands are drawn into a copy that is put back afterwards. Each band
+      // draws its primitives in the same depth order as the serial path, and vertex rows are
+      // rounded before being shifted by whole pixels, so the result is identical to drawing serially.
+#if cimg_use_openmp!=0
+      const int tile_height = cimg_object3d_tile_height;
+      bool is_tiled = !pboard && tile_height>0 && _depth==1 && _height>=2U*tile_height &&
+        (!zbuffer || (zbuffer._depth==1 && zbuffer._spectrum==1)) &&
+        (cimg::openmp_mode()==1 || (cimg::openmp_mode()>1 && nb_visibles>=(cimg_openmp_sizefactor)*256));
+      for (unsigned int l = 0; l<nb_visibles && is_tiled; ++l) { // Sprites, spheres and segments stay serial
+        const unsigned int n_primitive = visibles(permutations(l)), psize = primitives[n_primitive].size();
+        if (psize!=3 && psize!=4 && psize!=9 && psize!=12) is_tiled = false;
+        else if ((psize==9 || psize==12) && (n_primitive>=colors._width || !colors[n_primitive])) is_tiled = false;
+      }
+      if (is_tiled) {
+        const int nb_tiles = (int)(_height + tile_height - 1)/tile_height;
+        CImg<intT> rows(projections._width), tiles(nb_visibles,2);
+        CImg<uintT> bin_start(nb_tiles + 1,1,1,1,0);
+        cimg_forX(rows,n) rows[n] = cimg::uiround(projections(n,1));
+        for (unsigned int l = 0; l<nb_visibles; ++l) {
+          const CImg<tf>& primitive = primitives[visibles(permutations(l))];
+          const unsigned int psize = primitive.size(), nb_points = (psize==3 || psize==9)?3:4;
+          int ym = rows[(unsigned int)primitive[0]], yM = ym;
+          for (unsigned int i = 1; i<nb_points; ++i) {
+            const int y = rows[(unsigned int)primitive[i]];
+            if (y<ym) ym = y;
+            if (y>yM) yM = y;
+          }
+          tiles(l,0) = ym<0?0:ym/tile_height;
+          tiles(l,1) = yM>=height()?nb_tiles - 1:(yM<0?-1:yM/tile_height);
+          for (int t = tiles(l,0); t<=tiles(l,1); ++t) ++bin_start[t + 1];
+        }
+        for (int t = 0; t<nb_tiles; ++t) bin_start[t + 1]+=bin_start[t];
+        CImg<uintT> bins(std::max(bin_start[nb_tiles],1U)), bin_end(bin_start,false);
+        for (unsigned int l = 0; l<nb_visibles; ++l)
+          for (int t = tiles(l,0); t<=tiles(l,1); ++t) bins[bin_end[t]++] = l;
+
+        cimg_pragma_openmp(parallel for schedule(dynamic))
+        for (int t = 0; t<nb_tiles; ++t) if (bin_start[t + 1]>bin_start[t]) {
+          const int y0 = t*tile_height, y1 = std::min(height(),y0 + tile_height) - 1;
+          CImg<T> band = _spectrum==1?get_shared_rows(y0,y1):get_crop(0,y0,0,0,width() - 1,y1,0,spectrum() - 1);
+          CImg<tz> zband = zbuffer?zbuffer.get_shared_rows(y0,y1):CImg<tz>();
+          band._draw_object3d_primitives(pboard,zband,X,Y,Z,vertices,primitives,colors,opacities,
+                                         render_type,focale,absfocale,_focale,g_opacity,sprite_scale,
+                                         projections,lightprops,light_texture,visibles,permutations,
+                                         bins._data + bin_start[t],bin_start[t + 1] - bin_start[t],y0);
+          if (!band._is_shared) draw_image(0,y0,band);
+        }
+        if (render_type==5) cimg::mutex(10,0);
+        return *this;
+      }
+#endif
+      _draw_object3d_primitives(pboard,zbuffer,X,Y,Z,vertices,primitives,colors,opacities,
+                                render_type,focale,absfocale,_focale,g_opacity,sprite_scale,
+                                projections,lightprops,light_texture,visibles,permutations,0,nb_visibles);
+      if (render_type==5) cimg::mutex(10,0);
+      return *this;
+    }
+
+    // [internal] Hierarchical depth bounds of a z-buffer, used by _draw_object3d().
+    // For each tile of the z-buffer, keep the farthest depth it stores (the smallest inverse depth).
+    // The depth test only ever brings stored depths closer, so a bound that is out of date after
+    // drawing stays valid, only looser: tiles touched by a primitive are just flagged, and their
+    // bound is recomputed when a later test could not reject a primitive with the old one.
+    template<typename tz>
+    struct _draw_object3d_hiz {
+      CImg<tz> *zbuffer;
+      CImg<tz> far_depth;
+      CImg<ucharT> is_stale;
+      int tile;
+
+      _draw_object3d_hiz(CImg<tz>& zbuf, const int tile_size):zbuffer(&zbuf),tile(tile_size) {
+        if (tile<=0 || zbuf.is_empty() || zbuf._depth>1) { tile = 0; return; }
+        far_depth.assign((zbuf._width + tile - 1)/tile,(zbuf._height + tile - 1)/tile,1,1,(tz)0);
+        is_stale.assign(far_depth._width,far_depth._height,1,1,1);
+      }
+
+      operator bool() const { return tile>0; }
+
+      // Return true if every pixel of the rectangle [x0,x1]x[y0,y1] stores a depth closer
+      // than the inverse depth 'iz', i.e. if a primitive no closer than 'iz' cannot pass the depth test.
+      bool is_hidden(int x0, int y0, int x1, int y1, const float iz) {
+        x0 = std::max(x0,0); y0 = std::max(y0,0);
+        x1 = std::min(x1,zbuffer->width() - 1); y1 = std::min(y1,zbuffer->height() - 1);
+        if (x0>x1 || y0>y1) return false;
+        const float margin = iz*1e-4f; // Interpolated depths may round slightly past the vertex ones.
+        for (int ty = y0/tile; ty<=y1/tile; ++ty)
+          for (int tx = x0/tile; tx<=x1/tile; ++tx) {
+            tz &bound = far_depth(tx,ty);
+            if (bound>iz + margin) continue;
+            if (!is_stale(tx,ty)) return false;
+            const int
+              px0 = tx*tile, px1 = std::min(px0 + tile,zbuffer->width()) - 1,
+              py0 = ty*tile, py1 = std::min(py0 + tile,zbuffer->height()) - 1;
+            tz farthest = (*zbuffer)(px0,py0);
+            for (int y = py0; y<=py1; ++y) {
+              const tz *ptrz = zbuffer->data(px0,y);
+              for (int x = px0; x<=px1; ++x) { if (*ptrz<farthest) farthest = *ptrz; ++ptrz; }
+            }
+            bound = farthest;
+            is_stale(tx,ty) = 0;
+            if (bound<=iz + margin) return false;
+          }
+        return true;
+      }
+
+      // Flag the tiles of rectangle [x0,x1]x[y0,y1] as possibly drawn over.
+      void touch(int x0, int y0, int x1, int y1) {
+        x0 = std::max(x0,0); y0 = std::max(y0,0);
+        x1 = std::min(x1,zbuffer->width() - 1); y1 = std::min(y1,zbuffer->height() - 1);
+        if (x0>x1 || y0>y1) return;
+        for (int ty = y0/tile; ty<=y1/tile; ++ty)
+          for (int tx = x0/tile; tx<=x1/tile; ++tx) is_stale(tx,ty) = 1;
+      }
+    };
+
+    // Draw the visible primitives at the given positions of the depth order of an object (all of
+    // them if 'order' is null), with vertices already projected. Projected rows are shifted up by 'oy'
+    // after rounding, so that a band of rows starting at 'oy' can be drawn on its own. Used by _draw_object3d().
+    template<typename tz, typename tp, typename tf, typename tc, typename to, typename tpfloat>
+    void _draw_object3d_primitives(void *const pboard, CImg<tz>& zbuffer,
+                                   const float X, const float Y, const float Z,
+                                   const CImg<tp>& vertices,
+                                   const CImgList<tf>& primitives,
+                                   const CImgList<tc>& colors,
+                                   const to& opacities,
+                                   const unsigned int render_type,
+                                   const float focale, const float absfocale, const float _focale,
+                                   const float g_opacity, const float sprite_scale,
+                                   const CImg<tpfloat>& projections,
+                                   const CImg<floatT>& lightprops, const CImg<floatT>& light_texture,
+                                   const CImg<uintT>& visibles, const CImg<uintT>& permutations,
+                                   const unsigned int *const order, const unsigned int nb_order,
+                                   const int oy=0) {
+      typedef typename to::value_type _to;
+      cimg::unused(pboard);
       const CImg<tc> default_color(1,_spectrum,1,1,(tc)200);
       CImg<_to> _opacity;
+      _draw_object3d_hiz<tz> hiz(zbuffer,render_type?cimg_object3d_hiz_tile:0);
 
-      for (unsigned int l = 0; l<nb_visibles; ++l) {
+      for (unsigned int k = 0; k<nb_order; ++k) {
+        const unsigned int l = order?order[k]:k;
         const unsigned int n_primitive = visibles(permutations(l));
         const CImg<tf>& primitive = primitives[n_primitive];
+
+        // Skip lines, triangles and quadrangles lying behind everything already drawn under them.
+        int hx0 = 0, hy0 = 0, hx1 = -1, hy1 = -1;
+        if (hiz) {
+          const unsigned int
+            psize = (unsigned int)primitive.size(),
+            nb_points = psize==2 || psize==6?2:psize==3 || psize==9?3:psize==4 || psize==12?4:0;
+          float izmax = 0;
+          bool is_testable = nb_points>0;
+          for (unsigned int i = 0; i<nb_points; ++i) {
+            const unsigned int n = (unsigned int)primitive[i];
+            const int x = cimg::uiround(projections(n,0)), y = cimg::uiround(projections(n,1)) - oy;
+            const float z = (float)(vertices(n,2) + Z + _focale);
+            if (z<=0) is_testable = false;
+            else izmax = std::max(izmax,1/z);
+            if (!i) { hx0 = hx1 = x; hy0 = hy1 = y; }
+            else { hx0 = std::min(hx0,x); hx1 = std::max(hx1,x); hy0 = std::min(hy0,y); hy1 = std::max(hy1,y); }
+          }
+          if (is_testable && hiz.is_hidden(hx0,hy0,hx1,hy1,izmax)) continue;
+        }
         const CImg<tc>
           &__color = n_primitive<colors._width?colors[n_primitive]:CImg<tc>(),
           _color = (__color && __color.size()!=_spectrum && __color._spectrum<_spectrum)?
@@ -51229,7 +51880,7 @@ namespace cimg_library_suffixed {
         switch (primitive.size()) {
         case 1 : { // Colored point or sprite
           const unsigned int n0 = (unsigned int)primitive[0];
-          const int x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1));
+          const int x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy;
 
           if (_opacity.is_empty()) { // Scalar opacity
 
@@ -51302,8 +51953,8 @@ namespace cimg_library_suffixed {
             n0 = (unsigned int)primitive[0],
             n1 = (unsigned int)primitive[1];
           const int
-            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)),
-            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1));
+            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy,
+            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)) - oy;
           const float
             z0 = vertices(n0,2) + Z + _focale,
             z1 = vertices(n1,2) + Z + _focale;
@@ -51355,7 +52006,7 @@ namespace cimg_library_suffixed {
             zc = Z + Zc + _focale,
             af = absfocale?absfocale/zc:1,
             xc = X + Xc*af,
-            yc = Y + Yc*af;
+            yc = Y + Yc*af - oy;
           radius*=af;
 
           switch (render_type) {
@@ -51410,8 +52061,8 @@ namespace cimg_library_suffixed {
           const int
             tx0 = (int)primitive[2], ty0 = (int)primitive[3],
             tx1 = (int)primitive[4], ty1 = (int)primitive[5],
-            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)),
-            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1));
+            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy,
+            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)) - oy;
           const float
             z0 = vertices(n0,2) + Z + _focale,
             z1 = vertices(n1,2) + Z + _focale;
@@ -51446,9 +52097,9 @@ namespace cimg_library_suffixed {
             n1 = (unsigned int)primitive[1],
             n2 = (unsigned int)primitive[2];
           const int
-            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)),
-            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)),
-            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1));
+            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy,
+            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)) - oy,
+            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1)) - oy;
           const float
             z0 = vertices(n0,2) + Z + _focale,
             z1 = vertices(n1,2) + Z + _focale,
@@ -51568,10 +52219,10 @@ namespace cimg_library_suffixed {
             n2 = (unsigned int)primitive[2],
             n3 = (unsigned int)primitive[3];
           const int
-            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)),
-            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)),
-            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1)),
-            x3 = cimg::uiround(projections(n3,0)), y3 = cimg::uiround(projections(n3,1)),
+            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy,
+            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)) - oy,
+            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1)) - oy,
+            x3 = cimg::uiround(projections(n3,0)), y3 = cimg::uiround(projections(n3,1)) - oy,
             xc = (x0 + x1 + x2 + x3)/4, yc = (y0 + y1 + y2 + y3)/4;
           const float
             z0 = vertices(n0,2) + Z + _focale,
@@ -51741,9 +52392,9 @@ namespace cimg_library_suffixed {
             tx0 = (int)primitive[3], ty0 = (int)primitive[4],
             tx1 = (int)primitive[5], ty1 = (int)primitive[6],
             tx2 = (int)primitive[7], ty2 = (int)primitive[8],
-            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)),
-            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)),
-            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1));
+            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy,
+            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)) - oy,
+            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1)) - oy;
           const float
             z0 = vertices(n0,2) + Z + _focale,
             z1 = vertices(n1,2) + Z + _focale,
@@ -51881,10 +52532,10 @@ namespace cimg_library_suffixed {
             tx1 = (int)primitive[6], ty1 = (int)primitive[7],
             tx2 = (int)primitive[8], ty2 = (int)primitive[9],
             tx3 = (int)primitive[10], ty3 = (int)primitive[11],
-            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)),
-            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)),
-            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1)),
-            x3 = cimg::uiround(projections(n3,0)), y3 = cimg::uiround(projections(n3,1));
+            x0 = cimg::uiround(projections(n0,0)), y0 = cimg::uiround(projections(n0,1)) - oy,
+            x1 = cimg::uiround(projections(n1,0)), y1 = cimg::uiround(projections(n1,1)) - oy,
+            x2 = cimg::uiround(projections(n2,0)), y2 = cimg::uiround(projections(n2,1)) - oy,
+            x3 = cimg::uiround(projections(n3,0)), y3 = cimg::uiround(projections(n3,1)) - oy;
           const float
             z0 = vertices(n0,2) + Z + _focale,
             z1 = vertices(n1,2) + Z + _focale,
@@ -52041,9 +52692,8 @@ namespace cimg_library_suffixed {
           }
         } break;
         }
+        if (hiz) hiz.touch(hx0,hy0,hx1,hy1);
       }
-      if (render_type==5) cimg::mutex(10,0);
-      return *this;
     }
 
     //@}
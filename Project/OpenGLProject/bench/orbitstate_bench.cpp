@@ -0,0 +1,71 @@
+// Micro-benchmark for the orbital update kernels in orbitstate.cpp.
+// Needs no OpenGL, build it on its own, for example:
+//   g++ -O2 -mavx -I.. orbitstate_bench.cpp ../orbitstate.cpp -o orbitstate_bench
+//   cl /O2 /arch:AVX /I.. orbitstate_bench.cpp ..\orbitstate.cpp
+// Usage: orbitstate_bench [bodies] [iterations]
+
+#include "orbitstate.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+typedef void ( *KernelFunc )( float*, const float*, float, int );
+
+static OrbitState makeState( int count )
+{
+	OrbitState state;
+	state.Reserve( count );
+
+	std::mt19937 rng( 170 );
+	std::uniform_real_distribution<float> angle( 0.0f, 360.0f );
+	std::uniform_real_distribution<float> speed( -10.0f, 10.0f );
+
+	for( int i = 0; i < count; ++i )
+		state.Add( 1.0f, 10.0f, angle( rng ), speed( rng ), angle( rng ), speed( rng ), 0.0f );
+
+	return state;
+}
+
+// Returns bodies updated per second; both the orbit and spin angles count as one body update
+static double run( KernelFunc kernel, OrbitState& state, int iterations )
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for( int i = 0; i < iterations; ++i )
+	{
+		kernel( state.Orbit.data(), state.OrbitSpeed.data(), 1.0f, state.GetCount() );
+		kernel( state.Spin.data(), state.SpinSpeed.data(), 1.0f, state.GetCount() );
+	}
+
+	std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - start;
+	return (double)state.GetCount() * iterations / seconds.count();
+}
+
+int main( int argc, char** argv )
+{
+	int bodies = argc > 1 ? atoi( argv[1] ) : 1 << 20;
+	int iterations = argc > 2 ? atoi( argv[2] ) : 200;
+
+	OrbitState scalarState = makeState( bodies );
+	OrbitState vectorState = scalarState;
+
+	double scalar = run( IntegrateAnglesScalar, scalarState, iterations );
+	double vector = run( IntegrateAngles, vectorState, iterations );
+
+	// both kernels must agree exactly, they perform the same float operations
+	int mismatches = 0;
+	for( int i = 0; i < bodies; ++i )
+		if( scalarState.Orbit[i] != vectorState.Orbit[i] || scalarState.Spin[i] != vectorState.Spin[i] )
+			++mismatches;
+
+	std::cout << "bodies:     " << bodies << "\n";
+	std::cout << "iterations: " << iterations << "\n";
+	std::cout << "scalar:     " << scalar / 1e6 << " M bodies/s\n";
+	std::cout << IntegrateAnglesKernelName() << ":" << std::string( 11 - std::string( IntegrateAnglesKernelName() ).size(), ' ' )
+	          << vector / 1e6 << " M bodies/s (" << vector / scalar << "x)\n";
+	std::cout << "mismatches: " << mismatches << "\n";
+
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,830 @@
+// Rendering benchmark: texture loading, CImg's triangle rasterizer and 3D object drawing,
+// and the orbit scene at 10, 1k and 100k bodies, drawn both by the CPU renderer and with
+// headless OpenGL. Reports per-frame (or per-batch) percentiles and can write them all
+// as JSON, to compare builds against each other. Built by ../CMakeLists.txt; the orbit
+// scene parts need GLEW, glm and EGL and are only compiled in with BENCH_WITH_SCENE.
+// Usage: render_bench [--quick] [--json file] [--frames N] [--size WxH] [--threads N] [--data dir]
+
+#ifdef BENCH_WITH_SCENE
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+#include "glstate.h"
+#include "headless.h"
+#include "lod.h"
+#include "mesh.h"
+#include "scene.h"
+#include "shaderprogram.h"
+#include "skybox.h"
+#include "softrenderer.h"
+#include "threadpool.h"
+#include "uniformbuffer.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../CImg-3.3.6/CImg.h"
+using namespace cimg_library;
+
+#ifndef BENCH_DATA_DIR
+#define BENCH_DATA_DIR "."
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+	bool Quick;
+	int Frames; // 0 picks a count per body count
+	int Width;
+	int Height;
+	int Threads;
+	std::string Json;
+	std::string DataDir;
+};
+
+// One measured case. Samples are in milliseconds; Rate is Items per sample over the
+// mean sample time, e.g. frames/s or triangles/s.
+struct Result
+{
+	std::string Group;
+	std::string Name;
+	std::vector< std::pair<std::string, double> > Params;
+	int Samples;
+	double Mean, Min, P50, P90, P99, Max;
+	double Rate;
+	std::string RateUnit;
+};
+
+static std::vector<Result> Results;
+static std::vector<std::string> Skipped;
+static std::string GLRenderer;
+
+// The four named bodies of the scene use these, in layer order
+static const char* const PlanetTextureFiles[4] = { "donut3.bmp", "donut1.bmp", "snail.bmp", "pokeball.bmp" };
+
+/*=================================================================================================
+  STATISTICS
+=================================================================================================*/
+
+static double elapsedMs( Clock::time_point start )
+{
+	return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile( const std::vector<double>& sorted, double p )
+{
+	size_t rank = (size_t)std::ceil( p / 100.0 * sorted.size() );
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void record( const std::string& group, const std::string& name, const std::vector< std::pair<std::string, double> >& params,
+                    std::vector<double> samples, double items, const std::string& rateUnit )
+{
+	if( samples.empty() )
+		return;
+
+	std::sort( samples.begin(), samples.end() );
+
+	double sum = 0.0;
+	for( size_t i = 0; i < samples.size(); ++i )
+		sum += samples[i];
+
+	Result result;
+	result.Group = group;
+	result.Name = name;
+	result.Params = params;
+	result.Samples = (int)samples.size();
+	result.Mean = sum / samples.size();
+	result.Min = samples.front();
+	result.P50 = percentile( samples, 50.0 );
+	result.P90 = percentile( samples, 90.0 );
+	result.P99 = percentile( samples, 99.0 );
+	result.Max = samples.back();
+	result.Rate = result.Mean > 0.0 ? items * 1000.0 / result.Mean : 0.0;
+	result.RateUnit = rateUnit;
+	Results.push_back( result );
+
+	std::cout << "  " << std::left << std::setw( 46 ) << ( group + "/" + name ) << std::right << std::fixed << std::setprecision( 3 )
+	          << "  p50 " << std::setw( 10 ) << result.P50 << " ms"
+	          << "  p99 " << std::setw( 10 ) << result.P99 << " ms"
+	          << "  " << std::setprecision( 1 ) << std::setw( 12 ) << result.Rate << " " << rateUnit << "\n";
+}
+
+/*=================================================================================================
+  JSON
+=================================================================================================*/
+
+static std::string jsonString( const std::string& text )
+{
+	std::string out = "\"";
+
+	for( size_t i = 0; i < text.size(); ++i )
+	{
+		char c = text[i];
+		if( c == '"' || c == '\\' )
+			out += '\\';
+		if( (unsigned char)c < 0x20 )
+			out += ' ';
+		else
+			out += c;
+	}
+
+	return out + "\"";
+}
+
+static std::string number( double value )
+{
+	if( std::isfinite( value ) == false )
+		return "null";
+
+	std::ostringstream out;
+	out << std::setprecision( 9 ) << value;
+	return out.str();
+}
+
+static bool writeJson( const Options& opt )
+{
+	std::ofstream out( opt.Json.c_str() );
+	if( out.is_open() == false )
+	{
+		std::cerr << "could not write " << opt.Json << std::endl;
+		return false;
+	}
+
+	char timestamp[32] = "";
+	std::time_t now = std::time( NULL );
+	std::strftime( timestamp, sizeof( timestamp ), "%Y-%m-%dT%H:%M:%SZ", std::gmtime( &now ) );
+
+	out << "{\n";
+	out << "  \"benchmark\": \"render_bench\",\n";
+	out << "  \"version\": 1,\n";
+	out << "  \"timestamp\": " << jsonString( timestamp ) << ",\n";
+	out << "  \"config\": {\n";
+	out << "    \"width\": " << opt.Width << ",\n";
+	out << "    \"height\": " << opt.Height << ",\n";
+	out << "    \"quick\": " << ( opt.Quick ? "true" : "false" ) << ",\n";
+	out << "    \"threads\": " << opt.Threads << ",\n";
+	out << "    \"openmp\": " << ( cimg_use_openmp ? "true" : "false" ) << ",\n";
+	out << "    \"cimg_edge_lanes\": " << cimg_edge_lanes << ",\n";
+	out << "    \"gl_renderer\": " << ( GLRenderer.empty() ? "null" : jsonString( GLRenderer ) ) << "\n";
+	out << "  },\n";
+
+	out << "  \"skipped\": [";
+	for( size_t i = 0; i < Skipped.size(); ++i )
+		out << ( i ? ", " : "" ) << jsonString( Skipped[i] );
+	out << "],\n";
+
+	out << "  \"results\": [\n";
+	for( size_t i = 0; i < Results.size(); ++i )
+	{
+		const Result& r = Results[i];
+
+		out << "    { \"group\": " << jsonString( r.Group ) << ", \"name\": " << jsonString( r.Name ) << ", \"params\": {";
+		for( size_t p = 0; p < r.Params.size(); ++p )
+			out << ( p ? ", " : " " ) << jsonString( r.Params[p].first ) << ": " << number( r.Params[p].second ) << ( p + 1 == r.Params.size() ? " " : "" );
+		out << "},\n";
+		out << "      \"samples\": " << r.Samples << ", \"unit\": \"ms\""
+		    << ", \"mean\": " << number( r.Mean ) << ", \"min\": " << number( r.Min )
+		    << ", \"p50\": " << number( r.P50 ) << ", \"p90\": " << number( r.P90 )
+		    << ", \"p99\": " << number( r.P99 ) << ", \"max\": " << number( r.Max ) << ",\n";
+		out << "      \"rate\": " << number( r.Rate ) << ", \"rate_unit\": " << jsonString( r.RateUnit ) << " }"
+		    << ( i + 1 < Results.size() ? "," : "" ) << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+
+	return out.good();
+}
+
+/*=================================================================================================
+  TEXTURES
+=================================================================================================*/
+
+// Decoding alone, then the resize and RGB interleave that every loader does before the
+// upload: planet layers are 256x256, the skybox face is 1024x1024
+static void benchTextures( const Options& opt )
+{
+	static const char* const files[] = { "donut3.bmp", "donut1.bmp", "snail.bmp", "pokeball.bmp", "starsInSpace.bmp" };
+	int repeats = opt.Quick ? 3 : 10;
+
+	for( int f = 0; f < 5; ++f )
+	{
+		std::string path = opt.DataDir + "/" + files[f];
+		int size = f == 4 ? 1024 : 256;
+		std::vector<double> load, prepare;
+		int width = 0, height = 0;
+
+		for( int r = 0; r < repeats; ++r )
+		{
+			CImg<unsigned char> image;
+
+			Clock::time_point start = Clock::now();
+			try
+			{
+				image.load( path.c_str() );
+			}
+			catch( CImgException& )
+			{
+				Skipped.push_back( "texture " + path + ": could not load" );
+				break;
+			}
+			load.push_back( elapsedMs( start ) );
+			width = image.width();
+			height = image.height();
+
+			start = Clock::now();
+			image.resize( size, size, 1, 3 );
+
+			std::vector<unsigned char> data( 3 * size * size );
+			image.interleave_rgb( data.data() );
+			prepare.push_back( elapsedMs( start ) );
+		}
+
+		record( "texture_load", files[f], { { "width", width }, { "height", height } }, load, width * height / 1e6, "Mpixels/s" );
+		record( "texture_prepare", files[f], { { "size", size } }, prepare, size * size / 1e6, "Mpixels/s" );
+	}
+}
+
+/*=================================================================================================
+  TRIANGLES
+=================================================================================================*/
+
+struct Triangle
+{
+	int X[3], Y[3];
+	float Z[3];
+	int U[3], V[3];
+	float B[3];
+};
+
+static const char* const TriangleVariants[] = {
+	"flat", "flat_z", "gouraud", "gouraud_z", "textured", "textured_persp", "textured_persp_z", "textured_gouraud_persp_z", "phong"
+};
+const int NumTriangleVariants = 9;
+
+static void drawTriangles( int variant, const std::vector<Triangle>& tris, CImg<unsigned char>& image, CImg<float>& zbuffer,
+                           const CImg<unsigned char>& texture )
+{
+	static const unsigned char color[3] = { 200, 120, 40 };
+
+	for( size_t i = 0; i < tris.size(); ++i )
+	{
+		const Triangle& t = tris[i];
+
+		switch( variant ) {
+		case 0: image.draw_triangle( t.X[0], t.Y[0], t.X[1], t.Y[1], t.X[2], t.Y[2], color ); break;
+		case 1: image.draw_triangle( zbuffer, t.X[0], t.Y[0], t.Z[0], t.X[1], t.Y[1], t.Z[1], t.X[2], t.Y[2], t.Z[2], color ); break;
+		case 2: image.draw_triangle( t.X[0], t.Y[0], t.X[1], t.Y[1], t.X[2], t.Y[2], color, t.B[0], t.B[1], t.B[2] ); break;
+		case 3: image.draw_triangle( zbuffer, t.X[0], t.Y[0], t.Z[0], t.X[1], t.Y[1], t.Z[1], t.X[2], t.Y[2], t.Z[2], color, t.B[0], t.B[1], t.B[2] ); break;
+		case 4: image.draw_triangle( t.X[0], t.Y[0], t.X[1], t.Y[1], t.X[2], t.Y[2], texture, t.U[0], t.V[0], t.U[1], t.V[1], t.U[2], t.V[2] ); break;
+		case 5: image.draw_triangle( t.X[0], t.Y[0], t.Z[0], t.X[1], t.Y[1], t.Z[1], t.X[2], t.Y[2], t.Z[2], texture, t.U[0], t.V[0], t.U[1], t.V[1], t.U[2], t.V[2] ); break;
+		case 6: image.draw_triangle( zbuffer, t.X[0], t.Y[0], t.Z[0], t.X[1], t.Y[1], t.Z[1], t.X[2], t.Y[2], t.Z[2], texture, t.U[0], t.V[0], t.U[1], t.V[1], t.U[2], t.V[2] ); break;
+		case 7: image.draw_triangle( zbuffer, t.X[0], t.Y[0], t.Z[0], t.X[1], t.Y[1], t.Z[1], t.X[2], t.Y[2], t.Z[2], texture, t.U[0], t.V[0], t.U[1], t.V[1], t.U[2], t.V[2], t.B[0], t.B[1], t.B[2] ); break;
+		case 8: image.draw_triangle( t.X[0], t.Y[0], t.X[1], t.Y[1], t.X[2], t.Y[2], color, texture, t.U[0], t.V[0], t.U[1], t.V[1], t.U[2], t.V[2] ); break;
+		}
+	}
+}
+
+// Every draw_triangle variant on small, medium and large random triangles. Each sample
+// is one batch of triangles drawn into a cleared image and z-buffer; the batch sizes
+// keep the pixel area of a batch roughly the same for every triangle size.
+static void benchTriangles( const Options& opt )
+{
+	static const char* const sizeNames[3] = { "small", "medium", "large" };
+	static const int extents[3] = { 6, 40, 250 };
+	static const int counts[3] = { 20000, 800, 20 };
+	int batches = opt.Quick ? 5 : 30;
+
+	CImg<unsigned char> texture( 256, 256, 1, 3 );
+	texture.rand( 0, 255 );
+
+	CImg<unsigned char> image( opt.Width, opt.Height, 1, 3 );
+	CImg<float> zbuffer( opt.Width, opt.Height );
+
+	for( int s = 0; s < 3; ++s )
+	{
+		std::mt19937 rng( 170 + s );
+		std::uniform_int_distribution<int> cx( 0, opt.Width - 1 ), cy( 0, opt.Height - 1 );
+		std::uniform_int_distribution<int> offset( -extents[s], extents[s] ), uv( 0, 255 );
+		std::uniform_real_distribution<float> z( 1.0f, 10.0f ), brightness( 0.0f, 2.0f );
+
+		int count = opt.Quick ? counts[s] / 4 : counts[s];
+		std::vector<Triangle> tris( count );
+
+		for( int i = 0; i < count; ++i )
+		{
+			int x = cx( rng ), y = cy( rng );
+
+			for( int v = 0; v < 3; ++v )
+			{
+				tris[i].X[v] = x + offset( rng );
+				tris[i].Y[v] = y + offset( rng );
+				tris[i].Z[v] = z( rng );
+				tris[i].U[v] = uv( rng );
+				tris[i].V[v] = uv( rng );
+				tris[i].B[v] = brightness( rng );
+			}
+		}
+
+		for( int variant = 0; variant < NumTriangleVariants; ++variant )
+		{
+			std::vector<double> times;
+
+			for( int b = 0; b <= batches; ++b )
+			{
+				image.fill( 0 );
+				zbuffer.fill( 0.0f );
+
+				Clock::time_point start = Clock::now();
+				drawTriangles( variant, tris, image, zbuffer, texture );
+				if( b > 0 ) // the first batch warms the caches up
+					times.push_back( elapsedMs( start ) );
+			}
+
+			record( "draw_triangle", std::string( TriangleVariants[variant] ) + "_" + sizeNames[s],
+			        { { "triangles", count }, { "extent", extents[s] } }, times, count / 1e6, "Mtriangles/s" );
+		}
+	}
+}
+
+/*=================================================================================================
+  OBJECTS
+=================================================================================================*/
+
+static int framesFor( const Options& opt, int bodies )
+{
+	if( opt.Frames > 0 )
+		return opt.Frames;
+
+	int frames = opt.Quick ? 10 : 60;
+	return bodies >= 100000 ? std::max( 2, frames / 10 ) : frames;
+}
+
+// The orbit scene's bodies with CImg alone: the same layout, camera and textured, flat
+// shaded spheres as the software renderer, drawn one draw_object3d() call per body into
+// one frame and z-buffer on this thread. Measures _draw_object3d without the renderer's
+// tiling or thread pool, and builds without OpenGL.
+static void benchObjects( const Options& opt, const int* bodyCounts, int numBodyCounts )
+{
+	CImgList<unsigned int> primitives;
+	CImg<float> sphere = CImg<float>::sphere3d( primitives, 1.0f, 1 );
+
+	CImg<int> coords( sphere.width(), 2 );
+	cimg_forX( sphere, v )
+	{
+		coords( v, 0 ) = (int)( ( std::atan2( sphere( v, 0 ), sphere( v, 2 ) ) / ( 2.0f * 3.14159265f ) + 0.5f ) * 255.0f );
+		coords( v, 1 ) = (int)( std::acos( std::max( -1.0f, std::min( 1.0f, sphere( v, 1 ) ) ) ) / 3.14159265f * 255.0f );
+	}
+
+	CImgList<unsigned char> colors[4];
+	CImgList<unsigned int> layerPrimitives[4];
+	CImg<unsigned char> textures[4];
+
+	for( int layer = 0; layer < 4; ++layer )
+	{
+		try
+		{
+			textures[layer].load( ( opt.DataDir + "/" + PlanetTextureFiles[layer] ).c_str() );
+			textures[layer].resize( 256, 256, 1, 3 );
+		}
+		catch( CImgException& )
+		{
+			textures[layer].assign( 256, 256, 1, 3, 128 );
+		}
+
+		layerPrimitives[layer] = primitives;
+		colors[layer].assign( primitives.size() );
+		sphere.texturize_object3d( layerPrimitives[layer], colors[layer], textures[layer], coords );
+	}
+
+	int width = opt.Width, height = opt.Height;
+	float focale = 0.5f * height; // glm::frustum( -5, 5, -5, 5, 5, 200 ), as the scene
+	float scaleX = (float)width / (float)height;
+
+	// glm::lookAt( ( 0, 30, 10 ), origin, y up ) as right, up and forward axes
+	const float eye[3] = { 0.0f, 30.0f, 10.0f };
+	const float length = std::sqrt( 30.0f * 30.0f + 10.0f * 10.0f );
+	const float up[3] = { 0.0f, 10.0f / length, -30.0f / length };
+	const float forward[3] = { 0.0f, -30.0f / length, -10.0f / length };
+
+	const float step = (float)( ( 1.0 / 60.0 ) / 0.030 ); // one 60 Hz step in 30 ms ticks
+	const float toRadians = 3.14159265f / 180.0f;
+
+	for( int c = 0; c < numBodyCounts; ++c )
+	{
+		int count = bodyCounts[c];
+
+		// the four named bodies of CreateSceneBodies(), then the same distribution as
+		// Scene::AddRandomPlanets()
+		struct Body { float Radius, Distance, Orbit, OrbitSpeed, Spin, SpinSpeed; int Layer; };
+		std::vector<Body> bodies;
+		const Body named[4] = { { 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0 }, { 1.0f, 7.0f, 0.0f, 4.74f, 0.0f, 10.0f, 1 },
+		                        { 1.5f, 11.0f, 0.0f, 3.50f, 0.0f, 10.0f, 2 }, { 2.0f, 16.0f, 0.0f, 2.98f, 0.0f, 10.0f, 3 } };
+		for( int i = 0; i < std::min( count, 4 ); ++i )
+			bodies.push_back( named[i] );
+
+		std::mt19937 rng( 170 );
+		std::uniform_real_distribution<float> distance( 20.0f, 60.0f ), radius( 0.1f, 0.6f ), angle( 0.0f, 360.0f );
+		std::uniform_int_distribution<int> layer( 0, 3 );
+		for( int i = 4; i < count; ++i )
+		{
+			Body body;
+			body.Distance = distance( rng );
+			body.Radius = radius( rng );
+			body.Orbit = angle( rng );
+			body.OrbitSpeed = 4.74f * std::sqrt( 7.0f / body.Distance );
+			body.Spin = angle( rng );
+			body.SpinSpeed = 10.0f;
+			body.Layer = layer( rng );
+			bodies.push_back( body );
+		}
+
+		CImg<unsigned char> frame( width, height, 1, 3 );
+		CImg<float> zbuffer( width, height );
+		CImg<float> vertices( sphere.width(), 3 );
+		CImg<float> opacities;
+
+		int frames = framesFor( opt, count );
+		std::vector<double> times;
+		long drawn = 0;
+
+		for( int f = 0; f <= frames; ++f )
+		{
+			Clock::time_point start = Clock::now();
+			frame.fill( 0 );
+			zbuffer.fill( 0.0f );
+
+			for( size_t i = 0; i < bodies.size(); ++i )
+			{
+				Body& body = bodies[i];
+				body.Orbit += body.OrbitSpeed * step;
+				body.Spin += body.SpinSpeed * step;
+
+				float co = std::cos( body.Orbit * toRadians ), so = std::sin( body.Orbit * toRadians );
+				float cs = std::cos( body.Spin * toRadians ), ss = std::sin( body.Spin * toRadians );
+
+				// the same near plane test as the software renderer, and a screen test
+				float px = body.Distance * co - eye[0], py = -eye[1], pz = -body.Distance * so - eye[2];
+				float depth = px * forward[0] + py * forward[1] + pz * forward[2];
+				if( depth - body.Radius <= 1e-3f )
+					continue;
+
+				float sx = 0.5f * width + focale * px * scaleX / depth;
+				float sy = 0.5f * height - focale * ( px * up[0] + py * up[1] + pz * up[2] ) / depth;
+				float extent = focale * body.Radius / ( depth - body.Radius ) * std::max( scaleX, 1.0f );
+				if( sx + extent < 0 || sx - extent >= width || sy + extent < 0 || sy - extent >= height )
+					continue;
+
+				cimg_forX( sphere, v )
+				{
+					float x = sphere( v, 0 ) * body.Radius, y = sphere( v, 1 ) * body.Radius, z = sphere( v, 2 ) * body.Radius;
+					float bx = cs * x + ss * z + body.Distance, bz = -ss * x + cs * z;
+					float wx = co * bx + so * bz - eye[0], wy = y - eye[1], wz = -so * bx + co * bz - eye[2];
+
+					vertices( v, 0 ) = wx * scaleX;
+					vertices( v, 1 ) = -( wx * up[0] + wy * up[1] + wz * up[2] );
+					vertices( v, 2 ) = wx * forward[0] + wy * forward[1] + wz * forward[2];
+				}
+
+				frame.draw_object3d( 0.5f * width, 0.5f * height, -focale, vertices, layerPrimitives[body.Layer], colors[body.Layer], opacities,
+					3, false, focale, 0.0f, 0.0f, -5e8f, 0.0f, 0.0f, 1.0f, zbuffer );
+				++drawn;
+			}
+
+			if( f > 0 )
+				times.push_back( elapsedMs( start ) );
+		}
+
+		record( "draw_object3d", "bodies_" + std::to_string( count ),
+		        { { "bodies", count }, { "drawn_per_frame", (double)drawn / ( frames + 1 ) }, { "triangles_per_body", (double)primitives.size() } },
+		        times, 1, "frames/s" );
+	}
+}
+
+/*=================================================================================================
+  ORBIT SCENE
+=================================================================================================*/
+
+#ifdef BENCH_WITH_SCENE
+
+// Same bodies as CreateSceneBodies() in main.cpp, plus random ones up to count
+static void addBodies( Scene& scene, int count )
+{
+	scene.Clear();
+	if( count > 0 ) scene.AddPlanet( Planet( 5.0, 0, 0, 0, 0, 0, 0 ) );
+	if( count > 1 ) scene.AddPlanet( Planet( 1.0, 7, 0, 4.74, 0, 1 ) );
+	if( count > 2 ) scene.AddPlanet( Planet( 1.5, 11, 0, 3.50, 0, 2 ) );
+	if( count > 3 ) scene.AddPlanet( Planet( 2.0, 16, 0, 2.98, 0, 3 ) );
+
+	scene.AddRandomPlanets( std::max( 0, count - 4 ), 4, 170 );
+}
+
+static glm::mat4 sceneProjection( void )
+{
+	return glm::frustum( -5.0f, 5.0f, -5.0f, 5.0f, 5.0f, 200.0f );
+}
+
+static glm::mat4 sceneView( void )
+{
+	return glm::lookAt( glm::vec3( 0.0, 30.0, 10.0 ), glm::vec3( 0.0, 0.0, 0.0 ), glm::vec3( 0.0, 1.0, 0.0 ) );
+}
+
+static float sceneTicks( void )
+{
+	return (float)( ( 1.0 / 60.0 ) / 0.030 );
+}
+
+// run_software() without writing the frames: one simulation step and one render a frame
+static void benchSceneSoftware( const Options& opt, ThreadPool& pool, const int* bodyCounts, int numBodyCounts )
+{
+	std::string textures[4];
+	for( int i = 0; i < 4; ++i )
+		textures[i] = opt.DataDir + "/" + PlanetTextureFiles[i];
+
+	SoftwareRenderer renderer;
+	renderer.Create( textures, 4, 256, 20 );
+	renderer.SetThreadPool( &pool );
+
+	glm::mat4 projection = sceneProjection();
+	glm::mat4 view = sceneView();
+
+	for( int c = 0; c < numBodyCounts; ++c )
+	{
+		Scene scene;
+		scene.SetThreadPool( &pool );
+		addBodies( scene, bodyCounts[c] );
+
+		CImg<unsigned char> frame( opt.Width, opt.Height, 1, 3 );
+		int frames = framesFor( opt, bodyCounts[c] );
+		std::vector<double> times;
+
+		for( int f = 0; f <= frames; ++f )
+		{
+			Clock::time_point start = Clock::now();
+			scene.Simulate( 1, sceneTicks(), 0.0f );
+			frame.fill( 0 );
+			renderer.Render( scene, projection, view, frame );
+			if( f > 0 )
+				times.push_back( elapsedMs( start ) );
+		}
+
+		scene.WaitForSimulation();
+		record( "scene_software", "bodies_" + std::to_string( bodyCounts[c] ), { { "bodies", bodyCounts[c] } }, times, 1, "frames/s" );
+	}
+}
+
+// Layers resampled to one size, gray where a file cannot be loaded
+static GLuint loadLayers( const Options& opt, int size )
+{
+	GLuint texture;
+	glGenTextures( 1, &texture );
+	GLState.BindTexture( 0, GL_TEXTURE_2D_ARRAY, texture );
+	glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_RGB, size, size, 4, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL );
+
+	int pixels = size * size;
+	std::vector<unsigned char> data( 3 * pixels );
+
+	for( int layer = 0; layer < 4; ++layer )
+	{
+		CImg<unsigned char> image;
+		try
+		{
+			image.load( ( opt.DataDir + "/" + PlanetTextureFiles[layer] ).c_str() );
+			image.resize( size, size, 1, 3 );
+		}
+		catch( CImgException& )
+		{
+			image.assign( size, size, 1, 3, 128 );
+		}
+
+		image.interleave_rgb( data.data() );
+
+		glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, size, size, 1, GL_RGB, GL_UNSIGNED_BYTE, data.data() );
+	}
+
+	return texture;
+}
+
+// The headless frame of main.cpp (bodies, then the skybox) into an offscreen target.
+// glFinish() ends every frame, so a sample is the whole frame, GPU included.
+static void benchSceneGL( const Options& opt, ThreadPool& pool, const int* bodyCounts, int numBodyCounts )
+{
+	HeadlessContext context;
+	if( context.Create( 4, 2 ) == false )
+	{
+		Skipped.push_back( "scene_gl: no headless OpenGL context" );
+		return;
+	}
+
+	GLenum ret = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if( ret == GLEW_ERROR_NO_GLX_DISPLAY )
+		ret = GLEW_OK;
+#endif
+	if( ret != GLEW_OK )
+	{
+		Skipped.push_back( "scene_gl: GLEW initialization error" );
+		return;
+	}
+
+	GLRenderer = (const char*)glGetString( GL_RENDERER );
+	GLState.Invalidate();
+
+	OffscreenTarget target;
+	if( target.Create( opt.Width, opt.Height ) == false )
+	{
+		Skipped.push_back( "scene_gl: could not create the offscreen target" );
+		return;
+	}
+	target.Bind();
+	glViewport( 0, 0, opt.Width, opt.Height );
+
+	glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+	glEnable( GL_DEPTH_TEST );
+	glEnable( GL_CULL_FACE );
+	glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+
+	ShaderProgram instancedShader;
+	ShaderProgram skyboxShader;
+	instancedShader.Create( opt.DataDir + "/shaders/instanced.vert", opt.DataDir + "/shaders/instanced.frag" );
+	skyboxShader.Create( opt.DataDir + "/shaders/skybox.vert", opt.DataDir + "/shaders/skybox.frag" );
+	instancedShader.BindUniformBlock( "FrameConstants", FrameConstantsBinding );
+	skyboxShader.BindUniformBlock( "FrameConstants", FrameConstantsBinding );
+
+	UniformRing frameConstantsBuffer;
+	frameConstantsBuffer.Create( FrameConstantsBinding, sizeof( FrameConstants ), 3 );
+
+	Skybox skybox;
+	try
+	{
+		skybox.Create( opt.DataDir + "/starsInSpace.bmp", 1024 );
+	}
+	catch( CImgException& )
+	{
+		Skipped.push_back( "scene_gl: no skybox, starsInSpace.bmp could not be loaded" );
+	}
+
+	GLuint textures = loadLayers( opt, 256 );
+	GLuint sampler = GLStateCache::CreateSampler( GL_NEAREST, GL_NEAREST, GL_REPEAT );
+
+	const int segments[4] = { 40, 20, 12, 6 };
+	const float radii[3] = { 60.0f, 20.0f, 6.0f };
+	Mesh meshes[4];
+	for( int i = 0; i < 4; ++i )
+		meshes[i].CreateSphere( segments[i], segments[i] );
+
+	LodSelector selector;
+	selector.Create( radii, 4, 0.15f );
+
+	glm::mat4 projection = sceneProjection();
+	glm::mat4 view = sceneView();
+
+	FrameConstants constants;
+	constants.ProjectionMatrix = projection;
+	constants.ViewMatrix = view;
+	constants.AxisProjectionMatrix = glm::mat4( 1.0f );
+	constants.AxisViewMatrix = glm::mat4( 1.0f );
+	constants.AxisModelMatrix = glm::mat4( 1.0f );
+
+	for( int c = 0; c < numBodyCounts; ++c )
+	{
+		Scene scene;
+		scene.SetThreadPool( &pool );
+		addBodies( scene, bodyCounts[c] );
+		scene.CreateBuffers();
+		for( int i = 0; i < 4; ++i )
+			scene.AttachInstanceAttributes( meshes[i] );
+		scene.SetLodSelector( selector );
+
+		int frames = framesFor( opt, bodyCounts[c] ) * 4; // frames are cheap, more of them steady the percentiles
+		std::vector<double> times;
+
+		for( int f = 0; f <= frames; ++f )
+		{
+			Clock::time_point start = Clock::now();
+			scene.Simulate( 1, sceneTicks(), 0.0f );
+
+			glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+			frameConstantsBuffer.Update( &constants );
+
+			instancedShader.Use();
+			instancedShader.SetUniform( "planetTextures", 0 );
+			GLState.BindTexture( 0, GL_TEXTURE_2D_ARRAY, textures );
+			GLState.BindSampler( 0, sampler );
+
+			scene.Upload( projection, view, (float)opt.Height );
+			scene.Draw( meshes, 4 );
+
+			skyboxShader.Use();
+			skyboxShader.SetUniform( "skyboxTexture", 0 );
+			skybox.Draw();
+
+			glFinish();
+			GLState.EndFrame();
+
+			if( f > 0 )
+				times.push_back( elapsedMs( start ) );
+		}
+
+		scene.WaitForSimulation();
+		record( "scene_gl", "bodies_" + std::to_string( bodyCounts[c] ),
+		        { { "bodies", bodyCounts[c] }, { "visible", scene.GetNumVisible() } }, times, 1, "frames/s" );
+	}
+
+	glDeleteSamplers( 1, &sampler );
+	glDeleteTextures( 1, &textures );
+}
+
+#endif
+
+/*=================================================================================================
+  MAIN
+=================================================================================================*/
+
+int main( int argc, char** argv )
+{
+	Options opt;
+	opt.Quick = false;
+	opt.Frames = 0;
+	opt.Width = 800;
+	opt.Height = 800;
+	opt.Threads = 0;
+	opt.DataDir = BENCH_DATA_DIR;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		if( strcmp( argv[i], "--quick" ) == 0 )
+			opt.Quick = true;
+		else if( strcmp( argv[i], "--json" ) == 0 && i + 1 < argc )
+			opt.Json = argv[++i];
+		else if( strcmp( argv[i], "--frames" ) == 0 && i + 1 < argc )
+			opt.Frames = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--size" ) == 0 && i + 1 < argc )
+			sscanf( argv[++i], "%dx%d", &opt.Width, &opt.Height );
+		else if( strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc )
+			opt.Threads = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--data" ) == 0 && i + 1 < argc )
+			opt.DataDir = argv[++i];
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--quick] [--json file] [--frames N] [--size WxH] [--threads N] [--data dir]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( opt.Width <= 0 || opt.Height <= 0 )
+	{
+		std::cerr << "bad --size" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// missing files are reported once in the results, not by CImg on every attempt
+	cimg::exception_mode( 0 );
+
+	const int bodyCounts[3] = { 10, 1000, 100000 };
+
+	std::cout << "texture loading\n";
+	benchTextures( opt );
+
+	std::cout << "draw_triangle, " << opt.Width << "x" << opt.Height << "\n";
+	benchTriangles( opt );
+
+	std::cout << "draw_object3d, " << opt.Width << "x" << opt.Height << "\n";
+	benchObjects( opt, bodyCounts, 3 );
+
+#ifdef BENCH_WITH_SCENE
+	ThreadPool pool;
+	pool.Create( opt.Threads > 0 ? opt.Threads : ThreadPool::GetDefaultNumThreads() );
+	opt.Threads = pool.GetNumThreads();
+
+	std::cout << "orbit scene, software, " << opt.Width << "x" << opt.Height << "\n";
+	benchSceneSoftware( opt, pool, bodyCounts, 3 );
+
+	std::cout << "orbit scene, headless OpenGL, " << opt.Width << "x" << opt.Height << "\n";
+	benchSceneGL( opt, pool, bodyCounts, 3 );
+#else
+	Skipped.push_back( "scene_software, scene_gl: built without GLEW, glm and EGL" );
+#endif
+
+	for( size_t i = 0; i < Skipped.size(); ++i )
+		std::cout << "skipped: " << Skipped[i] << "\n";
+
+	if( opt.Json.empty() == false && writeJson( opt ) == false )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+#include "culling.h"
+#include <algorithm>
+#include <cmath>
+
+/*=================================================================================================
+  FRUSTUM
+=================================================================================================*/
+
+Frustum::Frustum()
+{
+	for( int p = 0; p < 6; ++p )
+		for( int i = 0; i < 4; ++i )
+			Planes[p][i] = 0.0f;
+}
+
+// glm is column-major: m[column][row]. Each plane is the fourth row plus or minus one
+// of the others, in the order left, right, bottom, top, near, far.
+void Frustum::Extract( const glm::mat4& m )
+{
+	for( int p = 0; p < 6; ++p )
+	{
+		int row = p / 2;
+		float sign = ( p % 2 == 0 ) ? 1.0f : -1.0f;
+
+		for( int i = 0; i < 4; ++i )
+			Planes[p][i] = m[i][3] + sign * m[i][row];
+
+		float length = sqrtf( Planes[p][0] * Planes[p][0] + Planes[p][1] * Planes[p][1] + Planes[p][2] * Planes[p][2] );
+
+		if( length > 0.0f )
+			for( int i = 0; i < 4; ++i )
+				Planes[p][i] /= length;
+	}
+}
+
+bool Frustum::TestSphere( float x, float y, float z, float radius ) const
+{
+	for( int p = 0; p < 6; ++p )
+		if( Planes[p][0] * x + Planes[p][1] * y + Planes[p][2] * z + Planes[p][3] < -radius )
+			return false;
+
+	return true;
+}
+
+// For each plane only the box corner furthest along the normal (to reject) and the one
+// furthest against it (to accept) need testing. The names avoid near/far, which
+// windows.h defines as macros.
+Frustum::Result Frustum::TestBox( const float* boxMin, const float* boxMax ) const
+{
+	Result result = Inside;
+
+	for( int p = 0; p < 6; ++p )
+	{
+		const float* plane = Planes[p];
+
+		float furthest = plane[3];
+		float nearest  = plane[3];
+
+		for( int i = 0; i < 3; ++i )
+		{
+			furthest += plane[i] * ( plane[i] >= 0.0f ? boxMax[i] : boxMin[i] );
+			nearest  += plane[i] * ( plane[i] >= 0.0f ? boxMin[i] : boxMax[i] );
+		}
+
+		if( furthest < 0.0f )
+			return Outside;
+
+		if( nearest < 0.0f )
+			result = Intersects;
+	}
+
+	return result;
+}
+
+/*=================================================================================================
+  BVH
+=================================================================================================*/
+
+BodyBVH::BodyBVH()
+{
+	BuiltArea = 0.0f;
+	NumRebuilds = 0;
+}
+
+void BodyBVH::Clear( void )
+{
+	Nodes.clear();
+	Indices.clear();
+	BuiltArea = 0.0f;
+}
+
+void BodyBVH::Build( const float* x, const float* y, const float* z, const float* radius, int count )
+{
+	Nodes.clear();
+	Indices.resize( count );
+
+	for( int i = 0; i < count; ++i )
+		Indices[i] = i;
+
+	if( count > 0 )
+	{
+		Node root;
+		root.First = 0;
+		root.Count = count;
+		root.Left = -1;
+
+		Nodes.reserve( 4 * ( count / LeafSize + 1 ) );
+		Nodes.push_back( root );
+		Split( x, y, z, 0 );
+	}
+
+	BuiltArea = RefitBounds( x, y, z, radius );
+	++NumRebuilds;
+}
+
+// Splits a node at the median of the longest axis of its body centers
+void BodyBVH::Split( const float* x, const float* y, const float* z, int index )
+{
+	int first = Nodes[index].First;
+	int count = Nodes[index].Count;
+
+	if( count <= LeafSize )
+		return;
+
+	const float* axes[3] = { x, y, z };
+	float lo[3] = {  1e30f,  1e30f,  1e30f };
+	float hi[3] = { -1e30f, -1e30f, -1e30f };
+
+	for( int i = first; i < first + count; ++i )
+	{
+		for( int a = 0; a < 3; ++a )
+		{
+			lo[a] = std::min( lo[a], axes[a][Indices[i]] );
+			hi[a] = std::max( hi[a], axes[a][Indices[i]] );
+		}
+	}
+
+	int axis = 0;
+	for( int a = 1; a < 3; ++a )
+		if( hi[a] - lo[a] > hi[axis] - lo[axis] )
+			axis = a;
+
+	const float* key = axes[axis];
+	int half = count / 2;
+
+	std::nth_element( Indices.begin() + first, Indices.begin() + first + half, Indices.begin() + first + count,
+		[key]( int a, int b ) { return key[a] < key[b]; } );
+
+	Node child;
+	child.Left = -1;
+
+	int left = (int)Nodes.size();
+	Nodes[index].Left = left;
+
+	child.First = first;
+	child.Count = half;
+	Nodes.push_back( child );
+
+	child.First = first + half;
+	child.Count = count - half;
+	Nodes.push_back( child );
+
+	Split( x, y, z, left );
+	Split( x, y, z, left + 1 );
+}
+
+// Children always come after their parent, so walking the array backwards visits every
+// node after both of its children. Returns the summed half-areas of all boxes.
+float BodyBVH::RefitBounds( const float* x, const float* y, const float* z, const float* radius )
+{
+	float area = 0.0f;
+
+	for( int n = (int)Nodes.size() - 1; n >= 0; --n )
+	{
+		Node& node = Nodes[n];
+
+		if( node.Left < 0 )
+		{
+			for( int a = 0; a < 3; ++a )
+			{
+				node.Min[a] =  1e30f;
+				node.Max[a] = -1e30f;
+			}
+
+			for( int i = node.First; i < node.First + node.Count; ++i )
+			{
+				int b = Indices[i];
+				float center[3] = { x[b], y[b], z[b] };
+
+				for( int a = 0; a < 3; ++a )
+				{
+					node.Min[a] = std::min( node.Min[a], center[a] - radius[b] );
+					node.Max[a] = std::max( node.Max[a], center[a] + radius[b] );
+				}
+			}
+		}
+		else
+		{
+			const Node& left = Nodes[node.Left];
+			const Node& right = Nodes[node.Left + 1];
+
+			for( int a = 0; a < 3; ++a )
+			{
+				node.Min[a] = std::min( left.Min[a], right.Min[a] );
+				node.Max[a] = std::max( left.Max[a], right.Max[a] );
+			}
+		}
+
+		float dx = node.Max[0] - node.Min[0];
+		float dy = node.Max[1] - node.Min[1];
+		float dz = node.Max[2] - node.Min[2];
+		area += dx * dy + dy * dz + dz * dx;
+	}
+
+	return area;
+}
+
+void BodyBVH::Refit( const float* x, const float* y, const float* z, const float* radius, int count )
+{
+	if( count != (int)Indices.size() )
+	{
+		Build( x, y, z, radius, count );
+		return;
+	}
+
+	float area = RefitBounds( x, y, z, radius );
+
+	if( area > 2.0f * BuiltArea )
+		Build( x, y, z, radius, count );
+}
+
+// Appends the index of every body whose bounding sphere touches the frustum. Subtrees
+// entirely inside are taken whole, without testing their bodies one by one.
+void BodyBVH::Query( const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, std::vector<int>& visible ) const
+{
+	if( Nodes.empty() )
+		return;
+
+	int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+
+	while( top > 0 )
+	{
+		const Node& node = Nodes[stack[--top]];
+		Frustum::Result result = frustum.TestBox( node.Min, node.Max );
+
+		if( result == Frustum::Outside )
+			continue;
+
+		if( result == Frustum::Inside )
+		{
+			visible.insert( visible.end(), Indices.begin() + node.First, Indices.begin() + node.First + node.Count );
+		}
+		else if( node.Left < 0 )
+		{
+			for( int i = node.First; i < node.First + node.Count; ++i )
+			{
+				int b = Indices[i];
+				if( frustum.TestSphere( x[b], y[b], z[b], radius[b] ) )
+					visible.push_back( b );
+			}
+		}
+		else
+		{
+			stack[top++] = node.Left;
+			stack[top++] = node.Left + 1;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// The six clip planes of a view-projection matrix (Gribb/Hartmann), normalized so
+// plane distances are in world units. Normals point into the frustum.
+class Frustum
+{
+public:
+	enum Result { Outside, Intersects, Inside };
+
+	Frustum();
+
+public:
+	void Extract( const glm::mat4& viewProjection );
+	bool TestSphere( float x, float y, float z, float radius ) const;
+	Result TestBox( const float* boxMin, const float* boxMax ) const;
+
+private:
+	float Planes[6][4];
+};
+
+// Bounding volume hierarchy of axis-aligned boxes over the bodies' bounding spheres.
+// The tree is built once with median splits and afterwards only refit: the topology
+// is kept and every box is recomputed from the bodies' new positions. Bodies on
+// neighbouring orbits drift apart over time, which makes boxes grow; once the boxes'
+// total area has more than doubled since the build, Refit() rebuilds the tree.
+class BodyBVH
+{
+public:
+	BodyBVH();
+
+public:
+	void Build( const float* x, const float* y, const float* z, const float* radius, int count );
+	void Refit( const float* x, const float* y, const float* z, const float* radius, int count );
+	void Query( const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, std::vector<int>& visible ) const;
+	void Clear();
+
+public:
+	int GetNumNodes() const { return (int)Nodes.size(); }
+	int GetNumRebuilds() const { return NumRebuilds; }
+
+private:
+	static const int LeafSize = 8;
+
+	// Every node covers Indices[First, First + Count); children are stored after their
+	// parent, Right == Left + 1, and Left < 0 marks a leaf
+	struct Node
+	{
+		float Min[3];
+		float Max[3];
+		int First;
+		int Count;
+		int Left;
+	};
+
+	void Split( const float* x, const float* y, const float* z, int index );
+	float RefitBounds( const float* x, const float* y, const float* z, const float* radius );
+
+	std::vector<Node> Nodes;
+	std::vector<int> Indices;
+	float BuiltArea;
+	int NumRebuilds;
+};
@@ -0,0 +1,175 @@
+#include "framegraph.h"
+#include "profiler.h"
+#include <iostream>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+FrameGraph::FrameGraph()
+{
+	Profiler = NULL;
+	Compiled = false;
+}
+
+/*=================================================================================================
+  PASSES
+=================================================================================================*/
+
+void FrameGraph::AddPass( const std::string& name, const PassFunc& func, const std::vector<std::string>& dependencies )
+{
+	Pass pass;
+	pass.Name = name;
+	pass.Func = func;
+	pass.Dependencies = dependencies;
+	pass.Enabled = true;
+
+	Passes.push_back( pass );
+	Compiled = false;
+}
+
+// Runs once after the last pass, e.g. glutSwapBuffers
+void FrameGraph::SetPresent( const PassFunc& func )
+{
+	Present = func;
+}
+
+// A disabled pass is skipped, but still orders the passes that depend on it
+void FrameGraph::SetPassEnabled( const std::string& name, bool enabled )
+{
+	int i = FindPass( name );
+
+	if( i >= 0 )
+		Passes[i].Enabled = enabled;
+}
+
+void FrameGraph::Clear( void )
+{
+	Passes.clear();
+	Order.clear();
+	Present = PassFunc();
+	Compiled = false;
+}
+
+int FrameGraph::FindPass( const std::string& name ) const
+{
+	for( size_t i = 0; i < Passes.size(); ++i )
+		if( Passes[i].Name == name )
+			return (int)i;
+
+	return -1;
+}
+
+/*=================================================================================================
+  COMPILE
+=================================================================================================*/
+
+// Topological sort. Each round picks the first pass, in insertion order, whose
+// dependencies have all been scheduled. Returns false (and prints the passes involved)
+// on unknown dependencies or cycles; those passes are left out of the frame.
+bool FrameGraph::Compile( void )
+{
+	Order.clear();
+
+	std::vector<bool> scheduled( Passes.size(), false );
+	bool ok = true;
+
+	for( size_t i = 0; i < Passes.size(); ++i )
+	{
+		for( size_t d = 0; d < Passes[i].Dependencies.size(); ++d )
+		{
+			if( FindPass( Passes[i].Dependencies[d] ) < 0 )
+			{
+				std::cerr << "frame graph: pass \"" << Passes[i].Name << "\" depends on unknown pass \"" << Passes[i].Dependencies[d] << "\"" << std::endl;
+				ok = false;
+			}
+		}
+	}
+
+	for( size_t round = 0; round < Passes.size(); ++round )
+	{
+		int next = -1;
+
+		for( size_t i = 0; i < Passes.size() && next < 0; ++i )
+		{
+			if( scheduled[i] )
+				continue;
+
+			bool ready = true;
+			for( size_t d = 0; d < Passes[i].Dependencies.size() && ready; ++d )
+			{
+				int dep = FindPass( Passes[i].Dependencies[d] );
+				ready = dep >= 0 && scheduled[dep];
+			}
+
+			if( ready )
+				next = (int)i;
+		}
+
+		if( next < 0 )
+			break;
+
+		scheduled[next] = true;
+		Order.push_back( next );
+	}
+
+	for( size_t i = 0; i < Passes.size(); ++i )
+	{
+		if( scheduled[i] == false )
+		{
+			std::cerr << "frame graph: pass \"" << Passes[i].Name << "\" has a dependency cycle or a missing dependency" << std::endl;
+			ok = false;
+		}
+	}
+
+	Compiled = true;
+	return ok;
+}
+
+std::vector<std::string> FrameGraph::GetExecutionOrder( void ) const
+{
+	std::vector<std::string> names;
+
+	for( size_t i = 0; i < Order.size(); ++i )
+		names.push_back( Passes[Order[i]].Name );
+
+	return names;
+}
+
+/*=================================================================================================
+  EXECUTE
+=================================================================================================*/
+
+void FrameGraph::Execute( void )
+{
+	if( Compiled == false )
+		Compile();
+
+	for( size_t i = 0; i < Order.size(); ++i )
+	{
+		const Pass& pass = Passes[Order[i]];
+
+		if( pass.Enabled && pass.Func )
+		{
+			if( Profiler != NULL )
+				Profiler->BeginScope( pass.Name );
+
+			pass.Func();
+
+			if( Profiler != NULL )
+				Profiler->EndScope();
+		}
+	}
+
+	// the swap is CPU time only, a GPU query around it would time nothing
+	if( Present )
+	{
+		if( Profiler != NULL )
+			Profiler->BeginScope( "present", false );
+
+		Present();
+
+		if( Profiler != NULL )
+			Profiler->EndScope();
+	}
+}
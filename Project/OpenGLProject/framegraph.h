@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class FrameProfiler;
+
+// Describes a frame as named render passes with explicit dependencies. Compile() orders
+// the passes so every pass runs after the passes it depends on (ties keep the order the
+// passes were added in), and Execute() runs them followed by exactly one present.
+// Reordering passes, e.g. to cut overdraw, only means changing dependencies.
+// With a profiler set, every pass and the present are timed as a scope of their own.
+class FrameGraph
+{
+public:
+	typedef std::function<void()> PassFunc;
+
+	FrameGraph();
+
+public:
+	void AddPass( const std::string& name, const PassFunc& func, const std::vector<std::string>& dependencies = std::vector<std::string>() );
+	void SetPresent( const PassFunc& func );
+	void SetPassEnabled( const std::string& name, bool enabled );
+	void SetProfiler( FrameProfiler* profiler ) { Profiler = profiler; }
+	void Clear();
+	bool Compile();
+	void Execute();
+
+public:
+	int GetNumPasses() const { return (int)Passes.size(); }
+	const std::string& GetPassName( int i ) const { return Passes[i].Name; }
+	std::vector<std::string> GetExecutionOrder() const;
+
+private:
+	struct Pass
+	{
+		std::string Name;
+		PassFunc Func;
+		std::vector<std::string> Dependencies;
+		bool Enabled;
+	};
+
+	int FindPass( const std::string& name ) const;
+
+	std::vector<Pass> Passes;
+	std::vector<int> Order;
+	PassFunc Present;
+	FrameProfiler* Profiler;
+	bool Compiled;
+};
@@ -0,0 +1,185 @@
+#include "glstate.h"
+
+GLStateCache GLState;
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+GLStateCache::GLStateCache()
+{
+	Issued = 0;
+	Skipped = 0;
+	FrameStartIssued = 0;
+	FrameStartSkipped = 0;
+	LastFrameIssued = 0;
+	LastFrameSkipped = 0;
+	DrawCalls = 0;
+	FrameStartDrawCalls = 0;
+	LastFrameDrawCalls = 0;
+
+	Invalidate();
+}
+
+/*=================================================================================================
+  INVALIDATE
+=================================================================================================*/
+
+// Forgets everything, so the next call of each kind is always sent to the driver
+void GLStateCache::Invalidate( void )
+{
+	Program = -1;
+	VertexArray = -1;
+	ActiveUnit = -1;
+
+	for( int unit = 0; unit < NumUnits; ++unit )
+	{
+		for( int target = 0; target < NumTargets; ++target )
+			Textures[unit][target] = -1;
+
+		Samplers[unit] = -1;
+	}
+
+	Caps.clear();
+}
+
+/*=================================================================================================
+  BINDINGS
+=================================================================================================*/
+
+bool GLStateCache::Changed( bool changed )
+{
+	if( changed )
+		++Issued;
+	else
+		++Skipped;
+
+	return changed;
+}
+
+int GLStateCache::TargetIndex( GLenum target )
+{
+	switch( target ) {
+		case GL_TEXTURE_2D:       return 0;
+		case GL_TEXTURE_2D_ARRAY: return 1;
+		case GL_TEXTURE_CUBE_MAP: return 2;
+	}
+	return -1;
+}
+
+void GLStateCache::UseProgram( GLuint program )
+{
+	if( Changed( Program != program ) )
+	{
+		glUseProgram( program );
+		Program = program;
+	}
+}
+
+void GLStateCache::BindVertexArray( GLuint vao )
+{
+	if( Changed( VertexArray != vao ) )
+	{
+		glBindVertexArray( vao );
+		VertexArray = vao;
+	}
+}
+
+// Selects the texture unit only when the binding on it really has to change
+void GLStateCache::BindTexture( GLuint unit, GLenum target, GLuint texture )
+{
+	int index = TargetIndex( target );
+
+	if( unit >= (GLuint)NumUnits || index < 0 )
+	{
+		++Issued;
+		glActiveTexture( GL_TEXTURE0 + unit );
+		glBindTexture( target, texture );
+		ActiveUnit = unit;
+		return;
+	}
+
+	if( Changed( Textures[unit][index] != texture ) )
+	{
+		if( ActiveUnit != unit )
+		{
+			glActiveTexture( GL_TEXTURE0 + unit );
+			ActiveUnit = unit;
+		}
+
+		glBindTexture( target, texture );
+		Textures[unit][index] = texture;
+	}
+}
+
+void GLStateCache::BindSampler( GLuint unit, GLuint sampler )
+{
+	if( unit >= (GLuint)NumUnits )
+	{
+		++Issued;
+		glBindSampler( unit, sampler );
+		return;
+	}
+
+	if( Changed( Samplers[unit] != sampler ) )
+	{
+		glBindSampler( unit, sampler );
+		Samplers[unit] = sampler;
+	}
+}
+
+void GLStateCache::Enable( GLenum cap )
+{
+	std::map<GLenum, bool>::iterator it = Caps.find( cap );
+
+	if( Changed( it == Caps.end() || it->second == false ) )
+	{
+		glEnable( cap );
+		Caps[cap] = true;
+	}
+}
+
+void GLStateCache::Disable( GLenum cap )
+{
+	std::map<GLenum, bool>::iterator it = Caps.find( cap );
+
+	if( Changed( it == Caps.end() || it->second == true ) )
+	{
+		glDisable( cap );
+		Caps[cap] = false;
+	}
+}
+
+/*=================================================================================================
+  SAMPLERS
+=================================================================================================*/
+
+// Sampler objects carry filtering and wrapping, so textures never need glTexParameteri
+// while drawing; they apply to the fixed-function pipeline as well as to shaders
+GLuint GLStateCache::CreateSampler( GLint minFilter, GLint magFilter, GLint wrap )
+{
+	GLuint sampler;
+	glGenSamplers( 1, &sampler );
+	glSamplerParameteri( sampler, GL_TEXTURE_MIN_FILTER, minFilter );
+	glSamplerParameteri( sampler, GL_TEXTURE_MAG_FILTER, magFilter );
+	glSamplerParameteri( sampler, GL_TEXTURE_WRAP_S, wrap );
+	glSamplerParameteri( sampler, GL_TEXTURE_WRAP_T, wrap );
+	glSamplerParameteri( sampler, GL_TEXTURE_WRAP_R, wrap );
+
+	return sampler;
+}
+
+/*=================================================================================================
+  COUNTERS
+=================================================================================================*/
+
+// Call once per frame, after the swap
+void GLStateCache::EndFrame( void )
+{
+	LastFrameIssued = Issued - FrameStartIssued;
+	LastFrameSkipped = Skipped - FrameStartSkipped;
+	FrameStartIssued = Issued;
+	FrameStartSkipped = Skipped;
+	LastFrameDrawCalls = DrawCalls - FrameStartDrawCalls;
+	FrameStartDrawCalls = DrawCalls;
+}
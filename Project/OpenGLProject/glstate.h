@@ -0,0 +1,66 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <map>
+
+// Shadow copy of the GL bindings the renderer changes most often. Every call compares
+// against the last value it set and only reaches the driver when something actually
+// changes. All code that binds programs, VAOs, textures or samplers, or toggles
+// capabilities, has to go through GLState, otherwise the shadow copy goes stale;
+// call Invalidate() after any code that bypasses it.
+class GLStateCache
+{
+public:
+	GLStateCache();
+
+public:
+	void UseProgram( GLuint program );
+	void BindVertexArray( GLuint vao );
+	void BindTexture( GLuint unit, GLenum target, GLuint texture );
+	void BindSampler( GLuint unit, GLuint sampler );
+	void Enable( GLenum cap );
+	void Disable( GLenum cap );
+	void Invalidate();
+
+	static GLuint CreateSampler( GLint minFilter, GLint magFilter, GLint wrap );
+
+public:
+	// Counters of state changes sent to the driver versus skipped as redundant
+	void EndFrame();
+	long long GetIssued()  const { return Issued;  }
+	long long GetSkipped() const { return Skipped; }
+	long long GetLastFrameIssued()  const { return LastFrameIssued;  }
+	long long GetLastFrameSkipped() const { return LastFrameSkipped; }
+
+	// Draw calls, counted by the code that issues them, per frame like the above
+	void CountDraw() { ++DrawCalls; }
+	long long GetLastFrameDrawCalls() const { return LastFrameDrawCalls; }
+
+private:
+	static const int NumUnits = 16;
+	static const int NumTargets = 3;
+
+	static int TargetIndex( GLenum target );
+	bool Changed( bool changed );
+
+	// 0 is a valid binding, so "unknown" is stored as -1 and always triggers the call
+	long long Program;
+	long long VertexArray;
+	long long ActiveUnit;
+	long long Textures[NumUnits][NumTargets];
+	long long Samplers[NumUnits];
+	std::map<GLenum, bool> Caps;
+
+	long long Issued;
+	long long Skipped;
+	long long FrameStartIssued;
+	long long FrameStartSkipped;
+	long long LastFrameIssued;
+	long long LastFrameSkipped;
+	long long DrawCalls;
+	long long FrameStartDrawCalls;
+	long long LastFrameDrawCalls;
+};
+
+extern GLStateCache GLState;
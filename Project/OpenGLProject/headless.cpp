@@ -0,0 +1,272 @@
+#include "headless.h"
+#include <iostream>
+#include <cstdio>
+#if defined( __linux__ )
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#include "../CImg-3.3.6/CImg.h"
+using namespace cimg_library;
+
+/*=================================================================================================
+  HEADLESS CONTEXT
+=================================================================================================*/
+
+HeadlessContext::HeadlessContext()
+{
+	Display = NULL;
+	Context = NULL;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	Delete();
+}
+
+#if defined( __linux__ )
+
+// Asks for a compatibility profile, which the legacy lighting setup in main.cpp still needs,
+// and makes it current without any surface; everything is drawn into an OffscreenTarget
+bool HeadlessContext::Create( int majorVersion, int minorVersion )
+{
+	Delete();
+
+	EGLDisplay display = EGL_NO_DISPLAY;
+
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if( getPlatformDisplay != NULL )
+		display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+
+	if( display == EGL_NO_DISPLAY )
+		display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint major, minor;
+	if( display == EGL_NO_DISPLAY || eglInitialize( display, &major, &minor ) == EGL_FALSE )
+	{
+		std::cerr << "headless: could not initialize an EGL display" << std::endl;
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint numConfigs = 0;
+
+	if( eglBindAPI( EGL_OPENGL_API ) == EGL_FALSE ||
+		eglChooseConfig( display, configAttributes, &config, 1, &numConfigs ) == EGL_FALSE || numConfigs == 0 )
+	{
+		std::cerr << "headless: no EGL config supports desktop OpenGL" << std::endl;
+		eglTerminate( display );
+		return false;
+	}
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION,       majorVersion,
+		EGL_CONTEXT_MINOR_VERSION,       minorVersion,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	EGLContext context = eglCreateContext( display, config, EGL_NO_CONTEXT, contextAttributes );
+
+	if( context == EGL_NO_CONTEXT )
+	{
+		std::cerr << "headless: could not create an OpenGL " << majorVersion << "." << minorVersion << " context" << std::endl;
+		eglTerminate( display );
+		return false;
+	}
+
+	if( eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) == EGL_FALSE )
+	{
+		std::cerr << "headless: the EGL context cannot be made current without a surface" << std::endl;
+		eglDestroyContext( display, context );
+		eglTerminate( display );
+		return false;
+	}
+
+	Display = display;
+	Context = context;
+	return true;
+}
+
+void HeadlessContext::Delete( void )
+{
+	if( Context != NULL )
+	{
+		eglMakeCurrent( (EGLDisplay)Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+		eglDestroyContext( (EGLDisplay)Display, (EGLContext)Context );
+		eglTerminate( (EGLDisplay)Display );
+	}
+
+	Display = NULL;
+	Context = NULL;
+}
+
+#else
+
+bool HeadlessContext::Create( int majorVersion, int minorVersion )
+{
+	std::cerr << "headless: offscreen contexts are only supported on Linux (EGL)" << std::endl;
+	return false;
+}
+
+void HeadlessContext::Delete( void )
+{
+	Display = NULL;
+	Context = NULL;
+}
+
+#endif
+
+/*=================================================================================================
+  OFFSCREEN TARGET
+=================================================================================================*/
+
+OffscreenTarget::OffscreenTarget()
+{
+	FBO = 0;
+	ColorRBO = 0;
+	DepthRBO = 0;
+	Width = 0;
+	Height = 0;
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+	Delete();
+}
+
+bool OffscreenTarget::Create( int width, int height )
+{
+	Delete();
+
+	Width = width;
+	Height = height;
+
+	glGenRenderbuffers( 1, &ColorRBO );
+	glBindRenderbuffer( GL_RENDERBUFFER, ColorRBO );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, width, height );
+
+	glGenRenderbuffers( 1, &DepthRBO );
+	glBindRenderbuffer( GL_RENDERBUFFER, DepthRBO );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height );
+	glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+	glGenFramebuffers( 1, &FBO );
+	glBindFramebuffer( GL_FRAMEBUFFER, FBO );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorRBO );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRBO );
+
+	if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+	{
+		std::cerr << "headless: the offscreen framebuffer is incomplete" << std::endl;
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		Delete();
+		return false;
+	}
+
+	return true;
+}
+
+void OffscreenTarget::Delete( void )
+{
+	if( FBO != 0 )
+	{
+		glDeleteFramebuffers( 1, &FBO );
+		glDeleteRenderbuffers( 1, &ColorRBO );
+		glDeleteRenderbuffers( 1, &DepthRBO );
+	}
+
+	FBO = 0;
+	ColorRBO = 0;
+	DepthRBO = 0;
+	Width = 0;
+	Height = 0;
+}
+
+void OffscreenTarget::Bind( void ) const
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, FBO );
+	glViewport( 0, 0, Width, Height );
+}
+
+// Reads the frame back and saves it with CImg; the format follows the file extension.
+// GL rows start at the bottom and are interleaved, CImg rows start at the top and are planar.
+bool OffscreenTarget::Save( const std::string& path )
+{
+	if( FBO == 0 )
+		return false;
+
+	int size = Width * Height;
+	Pixels.resize( 3 * size );
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, FBO );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, Pixels.data() );
+
+	CImg<unsigned char> image( Width, Height, 1, 3 );
+
+	for( int y = 0; y < Height; y++ )
+	{
+		const unsigned char* row = &Pixels[3 * ( Height - 1 - y ) * Width];
+
+		for( int x = 0; x < Width; x++ )
+		{
+			image( x, y, 0, 0 ) = row[3 * x + 0]; // red
+			image( x, y, 0, 1 ) = row[3 * x + 1]; // green
+			image( x, y, 0, 2 ) = row[3 * x + 2]; // blue
+		}
+	}
+
+	try
+	{
+		image.save( path.c_str() );
+	}
+	catch( CImgException& e )
+	{
+		std::cerr << "headless: could not write " << path << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Only a single %d or %0Nd is expanded, so a stray % in a path cannot be taken as some
+// other printf conversion. Without one, the number goes in front of the extension.
+std::string OffscreenTarget::FormatFramePath( const std::string& pattern, int frame )
+{
+	size_t start = pattern.find( '%' );
+	size_t end = start;
+	int width = 0;
+
+	if( start != std::string::npos )
+	{
+		end = start + 1;
+		while( end < pattern.size() && pattern[end] >= '0' && pattern[end] <= '9' )
+			width = 10 * width + ( pattern[end++] - '0' );
+
+		if( end >= pattern.size() || pattern[end] != 'd' )
+			start = std::string::npos;
+	}
+
+	if( width > 32 )
+		width = 32;
+
+	char number[48];
+	snprintf( number, sizeof( number ), "%0*d", width, frame );
+
+	if( start != std::string::npos )
+		return pattern.substr( 0, start ) + number + pattern.substr( end + 1 );
+
+	size_t dot = pattern.find_last_of( '.' );
+	size_t slash = pattern.find_last_of( "/\\" );
+
+	if( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) )
+		return pattern + number;
+
+	return pattern.substr( 0, dot ) + number + pattern.substr( dot );
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <string>
+#include <vector>
+
+// OpenGL context with no window and no display server, for render nodes without a GPU
+// or X server. On Linux it is created through EGL's surfaceless platform, which Mesa
+// serves with llvmpipe when there is no GPU. Other platforms have no headless path
+// yet and Create() fails.
+class HeadlessContext
+{
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+public:
+	bool Create( int majorVersion, int minorVersion );
+	void Delete();
+
+public:
+	bool IsCreated() const { return Context != NULL; }
+
+private:
+	// EGLDisplay and EGLContext, kept opaque so the EGL headers stay out of main.cpp
+	void* Display;
+	void* Context;
+};
+
+// Framebuffer object with a color and a depth renderbuffer that frames are drawn into
+// instead of a window, and read back from to be written to disk
+class OffscreenTarget
+{
+public:
+	OffscreenTarget();
+	~OffscreenTarget();
+
+public:
+	bool Create( int width, int height );
+	void Delete();
+	void Bind() const;
+	bool Save( const std::string& path );
+
+public:
+	GLuint GetFBO()    const { return FBO;    }
+	int    GetWidth()  const { return Width;  }
+	int    GetHeight() const { return Height; }
+
+	// Fills a printf-style pattern such as "frames/frame_%05d.bmp" with a frame number
+	static std::string FormatFramePath( const std::string& pattern, int frame );
+
+private:
+	GLuint FBO;
+	GLuint ColorRBO;
+	GLuint DepthRBO;
+	int Width;
+	int Height;
+	std::vector<unsigned char> Pixels;
+};
@@ -0,0 +1,58 @@
+#include "lod.h"
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+LodSelector::LodSelector()
+{
+	Hysteresis = 0.0f;
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+// thresholds holds numLevels - 1 decreasing radii, the boundary below each level
+void LodSelector::Create( const float* thresholds, int numLevels, float hysteresis )
+{
+	Thresholds.assign( thresholds, thresholds + ( numLevels > 1 ? numLevels - 1 : 0 ) );
+	Hysteresis = hysteresis;
+}
+
+/*=================================================================================================
+  SELECT
+=================================================================================================*/
+
+// current < 0 means the body has no level yet and gets the plain, hysteresis-free pick
+int LodSelector::Select( int current, float projectedRadius ) const
+{
+	int last = (int)Thresholds.size();
+
+	if( current < 0 || current > last )
+	{
+		int level = 0;
+		while( level < last && projectedRadius < Thresholds[level] )
+			++level;
+		return level;
+	}
+
+	int level = current;
+
+	while( level > 0 && projectedRadius > Thresholds[level - 1] * ( 1.0f + Hysteresis ) )
+		--level;
+
+	while( level < last && projectedRadius < Thresholds[level] * ( 1.0f - Hysteresis ) )
+		++level;
+
+	return level;
+}
+
+float LodSelector::ProjectedRadius( float viewDepth, float radius, float projectionScale, float viewportHeight )
+{
+	// bodies around or behind the camera are treated as huge, which keeps them detailed
+	if( viewDepth <= radius )
+		return 1e30f;
+
+	return radius * projectionScale * 0.5f * viewportHeight / viewDepth;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+// Picks a level of detail (0 = finest) from a body's projected radius in pixels.
+// Thresholds[i] is the smallest radius still drawn with level i. A body only changes
+// level once it is Hysteresis (a fraction) past a threshold, so bodies hovering right
+// at a boundary do not flip between two meshes every frame.
+class LodSelector
+{
+public:
+	LodSelector();
+
+public:
+	void Create( const float* thresholds, int numLevels, float hysteresis );
+	int  Select( int current, float projectedRadius ) const;
+
+public:
+	int GetNumLevels() const { return (int)Thresholds.size() + 1; }
+
+	// Radius in pixels of a sphere seen at viewDepth in front of the camera, where
+	// projectionScale is element [1][1] of the projection matrix
+	static float ProjectedRadius( float viewDepth, float radius, float projectionScale, float viewportHeight );
+
+private:
+	std::vector<float> Thresholds;
+	float Hysteresis;
+};
@@ -5,10 +5,28 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#include <algorithm>
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
 #include "shader.h"
 #include "shaderprogram.h"
-#include <../../../CImg-3.3.6/CImg.h>
+#include "mesh.h"
+#include "scene.h"
+#include "simclock.h"
+#include "orbitrings.h"
+#include "glstate.h"
+#include "framegraph.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "skybox.h"
+#include "headless.h"
+#include "softrenderer.h"
+#include "texturestreamer.h"
+#include "uniformbuffer.h"
+#include "../CImg-3.3.6/CImg.h"
 using namespace cimg_library;
 
 using namespace std;
@@ -37,6 +55,23 @@ bool mouse_states[8];
 
 // Other parameters
 bool draw_wireframe = false;
+bool draw_axis = false;
+bool draw_profiler = false;
+
+// Headless mode (--headless) draws into an offscreen framebuffer without any window and
+// writes every frame to disk. It runs for --frames N frames or --duration S simulated
+// seconds, each frame advancing the simulation by 1 / --fps seconds. --software does
+// the same with the CPU renderer and no OpenGL at all.
+bool headless = false;
+bool software = false;
+int headlessFrames = 0;
+double headlessSeconds = 0.0;
+double headlessFrameRate = 60.0;
+std::string headlessOutput = "frame_%05d.bmp";
+std::string traceOutput; // --trace file: a Chrome trace of the run, written when it ends
+int headlessFramesWritten = 0;
+HeadlessContext OffscreenContext;
+OffscreenTarget OffscreenFrame;
 
 /*=================================================================================================
 	SHADERS & TRANSFORMATIONS
@@ -44,11 +79,32 @@ bool draw_wireframe = false;
 
 ShaderProgram PassthroughShader;
 ShaderProgram PerspectiveShader;
+ShaderProgram InstancedShader;
+ShaderProgram OrbitShader;
+ShaderProgram SkyboxShader;
+
+// Linked programs from earlier launches, in ./shadercache, so startup skips the compiler
+ProgramBinaryCache ShaderCache;
+
+// The camera and axis matrices, uploaded once per frame and read by every program above
+// through their FrameConstants block; three copies, so the GPU can lag two frames behind
+UniformRing FrameConstantsBuffer;
+
+// Every frame is drawn by this graph of passes, see CreateFrameGraph()
+FrameGraph RenderGraph;
+
+// Times the passes of the last frames; the p key shows it, the t key writes a trace
+FrameProfiler Profiler;
+const int ProfilerHistory = 300;
 
 glm::mat4 PerspProjectionMatrix( 1.0f );
 glm::mat4 PerspViewMatrix( 1.0f );
 glm::mat4 PerspModelMatrix( 1.0f );
 
+// Matrices matching the fixed-function glFrustum/gluLookAt setup used by the planet scene
+glm::mat4 SceneProjectionMatrix( 1.0f );
+glm::mat4 SceneViewMatrix( 1.0f );
+
 float perspZoom = 1.0f, perspSensitivity = 0.35f;
 float perspRotationX = 0.0f, perspRotationY = 0.0f;
 
@@ -86,66 +142,49 @@ float axis_colors[] = {
 	0.0f, 0.0f, 1.0f, 1.0f
 };
 
-class Planet
-{
-public:
-	float radius;
-	float distance;
-	float orbit;
-	float orbitSpeed;
-	float axisAnimate;
-
-	Planet(float planetRadius, float planetDistance, float planetOrbit, float planetOrbitSpeed, float planetAxisAnimate) {
-		radius = planetRadius;
-		distance = planetDistance;
-		orbit = planetOrbit;
-		orbitSpeed = planetOrbitSpeed;
-		axisAnimate = planetAxisAnimate;
-	}
-};
-
-Planet donut3(5.0, 0, 0, 0, 0);				
-Planet donut1(1.0, 7, 0, 4.74, 0);		
-Planet snail(1.5, 11, 0, 3.50, 0);
-Planet pokeball(2.0, 16, 0, 2.98, 0);		
-
-int planetTurning = 0;
+// Unit spheres shared by every planet, from finest to coarsest tessellation. A body uses
+// level i while its projected radius is at least SphereLODRadii[i] pixels; it has to
+// cross a boundary by SphereLODHysteresis (a fraction) before it switches.
+const int NumSphereLODs = 4;
+const int SphereLODSegments[NumSphereLODs] = { 40, 20, 12, 6 };
+const float SphereLODRadii[NumSphereLODs - 1] = { 60.0f, 20.0f, 6.0f };
+const float SphereLODHysteresis = 0.15f;
+Mesh SphereMeshes[NumSphereLODs];
+
+// Workers that step the simulation while the GLUT thread draws, set with --threads N.
+// Declared before the scene so the scene (which waits on it) is destroyed first.
+ThreadPool SimulationPool;
+
+// Every orbiting body lives in the scene and is drawn with a single instanced call
+Scene PlanetScene;
+const int NumPlanetLayers = 4;
+const std::string PlanetTextureFiles[NumPlanetLayers] = { "donut3.bmp", "donut1.bmp", "snail.bmp", "pokeball.bmp" };
+int extraBodies = 0; // procedurally generated bodies, set with --bodies N
+
+// Orbit path of every body, shown with the q key
+OrbitRings PlanetOrbits;
+
+// The simulation runs in fixed steps, independent of how often frames are drawn.
+// Speeds are in degrees per 30 ms tick, the interval of the original glutTimerFunc animation.
+const double OrbitTickSeconds = 0.030;
+SimulationClock SimClock( 1.0 / 60.0, 8 );
+FrameLimiter FrameCap; // caps redisplays requested by idle_func, set with --fps N
 int planetOrbit = 0;
 int camera = 0;
 
-GLuint texturePlanet1, texturePlanet2, texturePlanet3, texturePlanet4, textureStars;
-
-GLuint loadTexture(const std::string& filename)
-{
-	CImg<unsigned char> texture;
-	texture.load(filename.c_str());
-
-	int size = texture.width() * texture.height();
-	unsigned char* data = new unsigned char[3 * size];
-
-	// Extract RGB components and store them in the data array
-	for (int i = 0; i < size; i++)
-	{
-		data[3 * i + 0] = texture.data()[0 * size + i]; // red
-		data[3 * i + 1] = texture.data()[1 * size + i]; // green
-		data[3 * i + 2] = texture.data()[2 * size + i]; // blue
-	}
+GLuint texturePlanets;
+GLuint samplerNearest; // nearest filtering with repeat, for the planets
 
-	GLuint textureId;
-	glGenTextures(1, &textureId);
-	glBindTexture(GL_TEXTURE_2D, textureId);
-
-	// Use the data array containing RGB components
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture.width(), texture.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	delete[] data; // Free allocated memory
-
-	return textureId;
-}
+// Textures are decoded on workers of their own, so waiting on the simulation never waits
+// on a file, and uploaded a few megabytes per frame; until then they show a placeholder.
+// Declared after the pools and before the skybox, the streamer's users.
+ThreadPool LoaderPool;
+TextureStreamer Textures;
+const int TextureStagingBytes = 16 << 20;
+const int TextureUploadBudget = 4 << 20; // bytes per frame
 
+// Star background, a cubemap built from starsInSpace.bmp
+Skybox StarSkybox;
 
 float positionLight[] = { 0.0, 0.0, -75.0, 1.0 }; //position of light
 static float positionAngle = 360; // half angle of light
@@ -182,168 +221,49 @@ void setup(void)
 
 
 
+// Draws the orbit path of every body in one instanced call; the rings were built once
+// in CreateScene() and the camera matrices must be current
 void orbit(void)
 {
-	glPushMatrix();
-	glColor3ub(255, 255, 255); // White color
+	if( OrbitShader.Use() == false )
+		return;
+	OrbitShader.SetUniform( "orbitColor", 1.0f, 1.0f, 1.0f, 1.0f ); // White color
 
-	// calculate points on the orbit circle for each object
-	float radius1 = donut1.distance;
-	float radius2 = snail.distance;
-	float radius3 = pokeball.distance;
-	const int numPoints = 100; // Adjust for desired smoothness
+	PlanetOrbits.Draw();
+}
 
-	// draw orbit for first object
-	glBegin(GL_LINES);
-	for (int i = 0; i < numPoints; ++i) {
-		float angle = 2 * M_PI * (float)i / (numPoints - 1);
-		glVertex3f(radius1 * cos(angle), 0.0f, radius1 * sin(angle)); // swap X and Z for orbit on X-axis
-	}
-	glEnd();
 
-	// draw orbit for second object (similar logic, swap X and Z)
-	glBegin(GL_LINES);
-	for (int i = 0; i < numPoints; ++i) {
-		float angle = 2 * M_PI * (float)i / (numPoints - 1);
-		glVertex3f(radius2 * cos(angle), 0.0f, radius2 * sin(angle));
-	}
-	glEnd();
 
-	// draw orbit for third object (similar logic, swap X and Z)
-	glBegin(GL_LINES);
-	for (int i = 0; i < numPoints; ++i) {
-		float angle = 2 * M_PI * (float)i / (numPoints - 1);
-		glVertex3f(radius3 * cos(angle), 0.0f, radius3 * sin(angle));
-	}
-	glEnd();
+void animate(void) {
+	//whole fixed steps owed since the last frame, none while paused; offline frames are evenly spaced in simulated time
+	int steps = headless ? SimClock.AdvanceBy(1.0 / headlessFrameRate) : SimClock.Advance();
+	float ticks = (float)(SimClock.GetStepSeconds() / OrbitTickSeconds);
 
-	glPopMatrix();
+	//publishes the state the workers finished last frame and starts them stepping the next one
+	PlanetScene.Simulate(steps, ticks, SimClock.GetAlpha());
 }
 
-
-
-void drawScene(void)
+void CreateSceneMatrices( void )
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);	//clears color and depth buffer to draw new scene
-	glLoadIdentity(); //load identity matrix to how objects will be translated, rotated or scaled before projecting onto screen
-
-
-	if (camera == 0)gluLookAt(0.0, 30.0, 10.0,0.0, 0.0, 0.0, 0.0, 1.0, 0.0);  //sets angles of camera
-	if (camera == 1)gluLookAt(0.0, 0.0, 30.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+	// PROJECTION MATRIX, same volume as the glFrustum call in resize()
+	SceneProjectionMatrix = glm::frustum( -5.0f, 5.0f, -5.0f, 5.0f, 5.0f, 200.0f );
 
-	if (planetOrbit == 1) //if this is checked to be 1 then calls onto orbit and draws path
-	{
-		orbit();
-	}
-
-	GLUquadric *quadric; // handles drawing four objects via quadric for drawins spheres
-	quadric = gluNewQuadric();
-
-	//donut3
-	glPushMatrix(); // pushes new matrix into stack into modelview matrix
-	glRotatef(donut3.orbit, 0.0, 1.0, 0.0);//applies a rotation around the Y-axis (because of 1.0 in the second parameter) by donut3.orbit degrees.
-	glTranslatef(donut3.distance, 0.0, 0.0); //distance from origin
-	
-	glPushMatrix();	//temp scope for transfomrations around its rotation around its axis
-	glRotatef(donut3.axisAnimate, 0.0, 1.0, 0.0); //rotates again but to itself
-	glRotatef(90.0, 1.0, 0.0, 0.0);// rotate 90 degrees on the x axis for texture to be correct
-	glEnable(GL_TEXTURE_2D);  // enables texture for drawing texture
-	glBindTexture(GL_TEXTURE_2D, texturePlanet1); //binds texture 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);	 // set texture to nearest neighbor 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);	//do it again
-	gluQuadricTexture(quadric, 1);	 //texture to this quadric
-	gluSphere(quadric, donut3.radius, 20.0, 20.0);	 //creates a quadric based on radius
-	glDisable(GL_TEXTURE_2D);  //disables drawing after drawing donut.3
-	glPopMatrix();	//pop
-	glPopMatrix();	//pop
-
-	//donut1
-	glPushMatrix();
-	glRotatef(donut1.orbit, 0.0, 1.0, 0.0);
-	glTranslatef(donut1.distance, 0.0, 0.0);
-	
-	glPushMatrix();
-	glRotatef(donut1.axisAnimate, 0.0, 1.0, 0.0);
-	glRotatef(90.0, 1.0, 0.0, 0.0);
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texturePlanet2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	gluQuadricTexture(quadric, 1);
-	gluSphere(quadric, donut1.radius, 20.0, 20.0);
-	glDisable(GL_TEXTURE_2D);
-	glPopMatrix();
-	glPopMatrix();
-
-	//snail
-	glPushMatrix();
-	glRotatef(snail.orbit, 0.0, 1.0, 0.0);
-	glTranslatef(snail.distance, 0.0, 0.0);
-	
-	glPushMatrix();
-	glRotatef(snail.axisAnimate, 0.0, 1.0, 0.0);
-	glRotatef(90.0, 1.0, 0.0, 0.0);
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texturePlanet3);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	gluQuadricTexture(quadric, 1);
-	gluSphere(quadric, snail.radius, 20.0, 20.0);
-	glDisable(GL_TEXTURE_2D);
-	glPopMatrix();
-	glPopMatrix();
-
-
-	//pokeball
-	glPushMatrix();
-	glRotatef(pokeball.orbit, 0.0, 1.0, 0.0);
-	glTranslatef(pokeball.distance, 0.0, 0.0);
-	
-	glPushMatrix();
-	glRotatef(pokeball.axisAnimate, 0.0, 1.0, 0.0);
-	glRotatef(90.0, 1.0, 0.0, 0.0);
-
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texturePlanet4);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	gluQuadricTexture(quadric, 1);
-	gluSphere(quadric, pokeball.radius, 20.0, 20.0);
-	glDisable(GL_TEXTURE_2D);
-	glPopMatrix();
-	glPopMatrix();
-	
+	// VIEW MATRIX, camera 0 or 1 as picked with the 1 and 2 keys
+	glm::vec3 eye   ( 0.0, 30.0, 10.0 );
+	glm::vec3 center( 0.0, 0.0, 0.0 );
+	glm::vec3 up    ( 0.0, 1.0, 0.0 );
 
-	glPushMatrix();
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, textureStars);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	glBegin(GL_POLYGON);
-	glTexCoord2f(-1.0, 0.0); glVertex3f(-200, -200, -100);
-	glTexCoord2f(2.0, 0.0); glVertex3f(200, -200, -100);
-	glTexCoord2f(2.0, 2.0); glVertex3f(200, 200, -100);
-	glTexCoord2f(-1.0, 2.0); glVertex3f(-200, 200, -100);
-	glEnd();
-
-	glBindTexture(GL_TEXTURE_2D, textureStars);
-	glBegin(GL_POLYGON);
-	glTexCoord2f(0.0, 0.0); glVertex3f(-200, -83, 200);
-	glTexCoord2f(8.0, 0.0); glVertex3f(200, -83, 200);
-	glTexCoord2f(8.0, 8.0); glVertex3f(200, -83, -200);
-	glTexCoord2f(0.0, 8.0); glVertex3f(-200, -83, -200);
-	glEnd();
-	glDisable(GL_TEXTURE_2D);
-	glPopMatrix();
+	if( camera == 1 )
+		eye = glm::vec3( 0.0, 0.0, 30.0 );
 
-	glutSwapBuffers();
+	SceneViewMatrix = glm::lookAt( eye, center, up );
 }
 
-
-
 void resize(int w, int h)					 
 {
+	WindowWidth  = w;
+	WindowHeight = h;
+
 	glViewport(0, 0, w, h);//sets new window width and height after resizing window 
 
 	glMatrixMode(GL_PROJECTION); //switches to project matrix to define 3d objects onto the 2d screen
@@ -355,29 +275,6 @@ void resize(int w, int h)
 	glMatrixMode(GL_MODELVIEW); //after resizing switches back to the posotion of camera or objects in scene
 }
 
-void animate(int n) {
-	if (planetTurning) 
-	{
-		donut1.orbit += donut1.orbitSpeed; //based on orbit speed values it keeps updating to move along the circle path
-		snail.orbit += snail.orbitSpeed;
-		pokeball.orbit += pokeball.orbitSpeed;
-		
-		if (donut1.orbit, snail.orbit, pokeball.orbit > 360.0)	// if it exceeds the 360 degrees then take away 360 to keep it in rotation
-		{
-			donut1.orbit, snail.orbit, pokeball.orbit-= 360.0;
-		}
-
-		donut1.axisAnimate += 10.0;	//same thing happens for when the balls turn themselves in orbit
-		snail.axisAnimate += 10.0;
-		pokeball.axisAnimate += 10.0;
-		
-		if (donut1.axisAnimate, snail.axisAnimate, pokeball.axisAnimate > 360.0) {
-			donut1.axisAnimate, snail.axisAnimate, pokeball.axisAnimate -= 360.0;
-		}
-		glutPostRedisplay();
-		glutTimerFunc(30, animate, 1);	//keeps updating after some time if true
-	}
-}
 
 
 
@@ -414,19 +311,62 @@ void CreateTransformationMatrices( void )
 	PerspModelMatrix = glm::scale( PerspModelMatrix, glm::vec3( perspZoom ) );
 }
 
+// Call after the matrices above are current for the frame
+void UploadFrameConstants( void )
+{
+	FrameConstants constants;
+	constants.ProjectionMatrix = SceneProjectionMatrix;
+	constants.ViewMatrix = SceneViewMatrix;
+	constants.AxisProjectionMatrix = PerspProjectionMatrix;
+	constants.AxisViewMatrix = PerspViewMatrix;
+	constants.AxisModelMatrix = PerspModelMatrix;
+
+	FrameConstantsBuffer.Update( &constants );
+}
+
+// All programs are submitted at once and built in the background, where the driver can;
+// passes skip drawing, or draw with a fallback, until their program is ready
 void CreateShaders( void )
 {
 	// Renders without any transformations
-	PassthroughShader.Create( "./shaders/simple.vert", "./shaders/simple.frag" );
+	PassthroughShader.CreateAsync( "./shaders/simple.vert", "./shaders/simple.frag" );
 
 	// Renders using perspective projection
-	PerspectiveShader.Create( "./shaders/persp.vert", "./shaders/persp.frag" );
+	PerspectiveShader.CreateAsync( "./shaders/persp.vert", "./shaders/persp.frag" );
+
+	// Renders every planet in one instanced draw call
+	InstancedShader.CreateAsync( "./shaders/instanced.vert", "./shaders/instanced.frag" );
+
+	// Flat gray planets while InstancedShader is being built; small enough to build right away
+	InstancedShader.SetFallback( InstancedShader.GetVariant( { "UNLIT", "UNTEXTURED" } ) );
+
+	// Renders the orbit path of every planet
+	OrbitShader.CreateAsync( "./shaders/orbit.vert", "./shaders/orbit.frag" );
+
+	// Renders the star background on the far plane
+	SkyboxShader.CreateAsync( "./shaders/skybox.vert", "./shaders/skybox.frag" );
+
+	// All of them read their matrices from the same buffer, and so do their variants
+	PerspectiveShader.BindUniformBlock( "FrameConstants", FrameConstantsBinding );
+	InstancedShader.BindUniformBlock( "FrameConstants", FrameConstantsBinding );
+	OrbitShader.BindUniformBlock( "FrameConstants", FrameConstantsBinding );
+	SkyboxShader.BindUniformBlock( "FrameConstants", FrameConstantsBinding );
 
 	//
 	// Additional shaders would be defined here
 	//
 }
 
+// Waits for every program, for runs whose frames must not depend on the driver's speed
+void FinishShaders( void )
+{
+	PassthroughShader.Finish();
+	PerspectiveShader.Finish();
+	InstancedShader.Finish();
+	OrbitShader.Finish();
+	SkyboxShader.Finish();
+}
+
 /*=================================================================================================
 	BUFFERS
 =================================================================================================*/
@@ -434,7 +374,7 @@ void CreateShaders( void )
 void CreateAxisBuffers( void )
 {
 	glGenVertexArrays( 1, &axis_VAO ); //generate 1 new VAO, its ID is returned in axis_VAO
-	glBindVertexArray( axis_VAO ); //bind the VAO so the subsequent commands modify it
+	GLState.BindVertexArray( axis_VAO ); //bind the VAO so the subsequent commands modify it
 
 	glGenBuffers( 2, &axis_VBO[0] ); //generate 2 buffers for data, their IDs are returned to the axis_VBO array
 
@@ -450,7 +390,7 @@ void CreateAxisBuffers( void )
 	glVertexAttribPointer( 1, 4, GL_FLOAT, GL_FALSE, 4 * sizeof( float ), (void*)0 ); //let GPU know this is attribute 1, made up of 4 floats
 	glEnableVertexAttribArray( 1 );
 
-	glBindVertexArray( 0 ); //unbind when done
+	GLState.BindVertexArray( 0 ); //unbind when done
 
 	//NOTE: You will probably not use an array for your own objects, as you will need to be
 	//      able to dynamically resize the number of vertices. Remember that the sizeof()
@@ -458,10 +398,76 @@ void CreateAxisBuffers( void )
 	//      have to do a calculation such as sizeof(v[0]) * v.size().
 }
 
+void CreateSphereMeshes( void )
+{
+	for( int i = 0; i < NumSphereLODs; ++i )
+		SphereMeshes[i].CreateSphere( SphereLODSegments[i], SphereLODSegments[i] );
+}
+
+// The bodies alone, which is all the software renderer needs
+void CreateSceneBodies( void )
+{
+	PlanetScene.Clear();
+
+	//                      radius  distance  orbit  orbitSpeed  axisAnimate  textureLayer  axisSpeed
+	PlanetScene.AddPlanet( Planet( 5.0, 0, 0, 0, 0, 0, 0 ) ); //donut3
+	PlanetScene.AddPlanet( Planet( 1.0, 7, 0, 4.74, 0, 1 ) ); //donut1
+	PlanetScene.AddPlanet( Planet( 1.5, 11, 0, 3.50, 0, 2 ) ); //snail
+	PlanetScene.AddPlanet( Planet( 2.0, 16, 0, 2.98, 0, 3 ) ); //pokeball
+
+	PlanetScene.AddRandomPlanets( extraBodies, NumPlanetLayers, 170 );
+}
+
+void CreateScene( void )
+{
+	CreateSceneBodies();
+
+	// the instance buffer is shared by every level of detail
+	PlanetScene.CreateBuffers();
+	for( int i = 0; i < NumSphereLODs; ++i )
+		PlanetScene.AttachInstanceAttributes( SphereMeshes[i] );
+
+	LodSelector selector;
+	selector.Create( SphereLODRadii, NumSphereLODs, SphereLODHysteresis );
+	PlanetScene.SetLodSelector( selector );
+
+	// orbit distances are fixed, so the rings are uploaded once
+	PlanetOrbits.Create( 100 );
+	PlanetOrbits.SetRadii( PlanetScene.GetState().Distance.data(), PlanetScene.GetNumPlanets() );
+}
+
 //
 //void CreateMyOwnObject( void ) ...
 //
 
+/*=================================================================================================
+	PROFILING
+=================================================================================================*/
+
+int headless_frame_count( void )
+{
+	if( headlessFrames > 0 )
+		return headlessFrames;
+
+	return headlessSeconds > 0.0 ? (int)ceil( headlessSeconds * headlessFrameRate ) : 1;
+}
+
+// Averages and histogram of the frames the profiler kept
+void print_profile( void )
+{
+	std::vector<std::string> lines = Profiler.GetReport();
+	for( size_t i = 0; i < lines.size(); ++i )
+		std::cout << lines[i] << "\n";
+}
+
+// Only when --trace asked for it
+void write_trace( void )
+{
+	if( traceOutput.empty() == false && Profiler.WriteTrace( traceOutput ) )
+		std::cout << "Wrote a trace of " << Profiler.GetNumFrames() << " frames to " << traceOutput << "\n";
+}
+
+
 /*=================================================================================================
 	CALLBACKS
 =================================================================================================*/
@@ -474,8 +480,11 @@ void CreateAxisBuffers( void )
 
 void idle_func()
 {
-	//uncomment below to repeatedly draw new frames
-	glutPostRedisplay();
+	// draw a new frame once per frame interval, and sleep instead of spinning in between
+	if( FrameCap.IsFrameDue() )
+		glutPostRedisplay();
+	else
+		std::this_thread::sleep_for( std::chrono::duration<double>( FrameCap.GetSecondsUntilNextFrame() ) );
 }
 
 void reshape_func( int width, int height )
@@ -502,6 +511,15 @@ void keyboard_func( unsigned char key, int x, int y )
 				std::cout << "Wireframes off.\n";
 			break;
 		}
+		case 'f':
+		{
+			PlanetScene.SetCulling( !PlanetScene.IsCulling() );
+			if( PlanetScene.IsCulling() == true )
+				std::cout << "Frustum culling on.\n";
+			else
+				std::cout << "Frustum culling off.\n";
+			break;
+		}
 
 		// Exit on escape key press
 		case '\x1B':
@@ -511,15 +529,14 @@ void keyboard_func( unsigned char key, int x, int y )
 		}
 		case' ':
 		{
-			if (planetTurning)
+			if (SimClock.IsPaused())
 			{
-				planetTurning = 0;
+				SimClock.Resume();
 				break;
 			}
 			else
 			{
-				planetTurning = 1;
-				animate(1);
+				SimClock.Pause();
 				break;
 			}
 		}
@@ -528,16 +545,49 @@ void keyboard_func( unsigned char key, int x, int y )
 			if (planetOrbit)
 			{
 				planetOrbit = 0;
+				RenderGraph.SetPassEnabled("orbits", false);
 				glutPostRedisplay();
 				break;
 			}
 			else
 			{
 				planetOrbit = 1;
+				RenderGraph.SetPassEnabled("orbits", true);
 				glutPostRedisplay();
 				break;
 			}
 		}
+		case 'a':
+		{
+			draw_axis = !draw_axis;
+			glutPostRedisplay();
+			break;
+		}
+		case 'p':
+		{
+			draw_profiler = !draw_profiler;
+			glutPostRedisplay();
+			break;
+		}
+		case 't':
+		{
+			if( Profiler.WriteTrace( "trace.json" ) )
+				std::cout << "Wrote the last " << Profiler.GetNumFrames() << " frames to trace.json\n";
+			break;
+		}
+		case 'c':
+		{
+			std::cout << "GL state changes last frame: " << GLState.GetLastFrameIssued() << " issued, "
+			          << GLState.GetLastFrameSkipped() << " skipped as redundant\n";
+			std::cout << "Bodies drawn: " << PlanetScene.GetNumVisible() << " of " << PlanetScene.GetNumPlanets()
+			          << ( PlanetScene.IsCulling() ? "" : " (culling off)" ) << ", BVH rebuilds: " << PlanetScene.GetNumBVHRebuilds() << "\n";
+			std::cout << "Bodies per sphere level of detail:";
+			for( int i = 0; i < NumSphereLODs; ++i )
+				std::cout << " " << PlanetScene.GetLodCount( i );
+			std::cout << "\n";
+			print_profile();
+			break;
+		}
 		case '1':
 		{
 			camera = 0;
@@ -632,19 +682,16 @@ void active_motion_func( int x, int y )
 	RENDERING
 =================================================================================================*/
 
-void display_func( void )
+// Depth and color are cleared once per frame, here and nowhere else
+void clear_pass( void )
 {
-	// Clear the contents of the back buffer
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+}
 
-	// Update transformation matrices
-	CreateTransformationMatrices();
-
-	// Choose which shader to user, and send the transformation matrix information to it
-	PerspectiveShader.Use();
-	PerspectiveShader.SetUniform( "projectionMatrix", glm::value_ptr( PerspProjectionMatrix ), 4, GL_FALSE, 1 );
-	PerspectiveShader.SetUniform( "viewMatrix", glm::value_ptr( PerspViewMatrix ), 4, GL_FALSE, 1 );
-	PerspectiveShader.SetUniform( "modelMatrix", glm::value_ptr( PerspModelMatrix ), 4, GL_FALSE, 1 );
+void bodies_pass( void )
+{
+	if( InstancedShader.Use() == false )
+		return;
 
 	// Drawing in wireframe?
 	if( draw_wireframe == true )
@@ -652,21 +699,121 @@ void display_func( void )
 	else
 		glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 
+	InstancedShader.SetUniform( "planetTextures", 0 );
+
+	GLState.BindTexture( 0, GL_TEXTURE_2D_ARRAY, texturePlanets );
+	GLState.BindSampler( 0, samplerNearest ); // replaces per-draw glTexParameteri calls
+
+	// one draw call per sphere level of detail
+	{
+		ProfileScope scope( Profiler, "upload instances" );
+		PlanetScene.Upload( SceneProjectionMatrix, SceneViewMatrix, (float)WindowHeight );
+	}
+	PlanetScene.Draw( SphereMeshes, NumSphereLODs );
+
+	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+}
+
+void orbits_pass( void )
+{
+	orbit();
+}
+
+// Runs after the opaque passes: the sky sits on the far plane, so early depth
+// rejection skips every pixel a planet already covers
+void skybox_pass( void )
+{
+	if( SkyboxShader.Use() == false )
+		return;
+	SkyboxShader.SetUniform( "skyboxTexture", 0 );
+
+	StarSkybox.Draw();
+}
+
+// Axis gizmo, rotated with the mouse and shown with the a key; drawn over everything
+void overlay_pass( void )
+{
+	if( draw_axis == false )
+		return;
+
+	// Choose which shader to use; its matrices come from the FrameConstants block
+	if( PerspectiveShader.Use() == false )
+		return;
+
 	// Bind the axis Vertex Array Object created earlier, and draw it
-	glBindVertexArray( axis_VAO );
+	GLState.Disable( GL_DEPTH_TEST );
+	GLState.BindVertexArray( axis_VAO );
 	glDrawArrays( GL_LINES, 0, 6 ); // 6 = number of vertices in the object
+	GLState.CountDraw();
+	GLState.Enable( GL_DEPTH_TEST );
+}
 
-	//
-	// Bind and draw your object here
-	//
-
-	drawScene();
+// Frame timings over everything else, shown with the p key. The bitmap font needs
+// glutInit(), so there is no overlay headless.
+void profiler_pass( void )
+{
+	if( draw_profiler == false || headless )
+		return;
 
-	// Unbind when done
-	glBindVertexArray( 0 );
+	Profiler.DrawOverlay( 10, WindowHeight - 20 );
+}
 
-	// Swap the front and back buffers
+void present( void )
+{
+	// Swap the front and back buffers, the only swap of the frame
 	glutSwapBuffers();
+	GLState.EndFrame();
+}
+
+// Headless frames are read back from the offscreen framebuffer and written to disk
+void save_frame( void )
+{
+	std::string path = OffscreenTarget::FormatFramePath( headlessOutput, headlessFramesWritten );
+
+	if( OffscreenFrame.Save( path ) )
+		++headlessFramesWritten;
+
+	GLState.EndFrame();
+}
+
+// Passes and their dependencies; the graph decides the order they run in
+void CreateFrameGraph( void )
+{
+	RenderGraph.Clear();
+	RenderGraph.AddPass( "clear", clear_pass );
+	RenderGraph.AddPass( "opaque bodies", bodies_pass, { "clear" } );
+	RenderGraph.AddPass( "orbits", orbits_pass, { "clear" } );
+	RenderGraph.AddPass( "skybox", skybox_pass, { "opaque bodies", "orbits" } );
+	RenderGraph.AddPass( "overlay", overlay_pass, { "opaque bodies", "orbits", "skybox" } );
+	RenderGraph.AddPass( "profiler", profiler_pass, { "overlay" } );
+	RenderGraph.SetPresent( headless ? save_frame : present );
+	RenderGraph.SetProfiler( &Profiler );
+	RenderGraph.SetPassEnabled( "orbits", planetOrbit == 1 );
+	RenderGraph.Compile();
+}
+
+void display_func( void )
+{
+	Profiler.BeginFrame();
+
+	{
+		ProfileScope scope( Profiler, "simulate", false );
+		animate(); //catch the simulation up to the current time
+	}
+
+	// Update transformation matrices
+	CreateSceneMatrices();
+	CreateTransformationMatrices();
+	UploadFrameConstants();
+
+	{
+		ProfileScope scope( Profiler, "texture uploads" );
+		Textures.Update( TextureUploadBudget ); // whatever finished loading since the last frame
+	}
+
+	RenderGraph.Execute();
+
+	Profiler.EndFrame();
 }
 
 /*=================================================================================================
@@ -685,13 +832,34 @@ void init( void )
 	glClearColor( 0.0f, 0.0f, 0.0f, 0.0f ); // background color
 	glEnable( GL_DEPTH_TEST ); // enable depth test
 	glEnable( GL_CULL_FACE ); // enable back-face culling
+	glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS ); // filter across cubemap face edges
 
 	// Create shaders
+	ShaderCache.Create( "./shadercache" );
+	ShaderProgram::SetBinaryCache( &ShaderCache );
 	CreateShaders();
+	if( ShaderCache.IsEnabled() )
+		std::cout << "Shader cache:   " << ShaderCache.GetNumHits() << " programs loaded, " << ShaderCache.GetNumMisses() + ShaderCache.GetNumRejected() << " compiled\n\n";
+	FrameConstantsBuffer.Create( FrameConstantsBinding, sizeof( FrameConstants ), 3 );
+
+	// GPU timer queries for the profiler; a headless run keeps all of its frames
+	Profiler.Create( headless ? std::max( ProfilerHistory, headless_frame_count() ) : ProfilerHistory, true );
+
+	// Filtering and wrapping live in a sampler, bound once per texture unit while drawing
+	samplerNearest = GLStateCache::CreateSampler( GL_NEAREST, GL_NEAREST, GL_REPEAT );
 
 	// Create axis buffers
 	CreateAxisBuffers();
 
+	// Create the sphere meshes shared by all planets
+	CreateSphereMeshes();
+
+	// Describe how a frame is drawn
+	CreateFrameGraph();
+
+	// Create the planets and their instance buffer
+	CreateScene();
+
 	//
 	// Consider calling a function to create your object here
 	//
@@ -703,53 +871,213 @@ void init( void )
 	MAIN
 =================================================================================================*/
 
+// Draws the requested number of frames as fast as the context allows, then quits.
+// The clock starts running right away, unlike the windowed mode.
+int run_headless( void )
+{
+	int frames = headless_frame_count();
+
+	std::cout << "Rendering " << frames << " frames of " << WindowWidth << "x" << WindowHeight << " to " << headlessOutput << "\n";
+
+	// every frame with its real textures and programs, however long they take to load
+	Textures.Finish();
+	FinishShaders();
+
+	auto start = std::chrono::steady_clock::now();
+
+	SimClock.Resume();
+	for( int frame = 0; frame < frames; ++frame )
+		display_func();
+
+	glFinish();
+	PlanetScene.WaitForSimulation();
+	Profiler.ReadBack(); // the last two frames' queries
+
+	double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	std::cout << "Wrote " << headlessFramesWritten << " frames in " << seconds << " s (" << headlessFramesWritten / seconds << " frames/s)\n\n";
+
+	print_profile();
+	write_trace();
+
+	return headlessFramesWritten == frames ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Same frames as run_headless(), drawn by the CPU renderer. Only the planets are drawn,
+// on black; there is no skybox, orbit paths or axis gizmo.
+int run_software( void )
+{
+	int frames = headless_frame_count();
+	int written = 0;
+
+	std::cout << "Rendering " << frames << " frames of " << WindowWidth << "x" << WindowHeight << " to " << headlessOutput << " in software\n";
+
+	CreateSceneBodies();
+
+	SoftwareRenderer renderer;
+	renderer.Create( PlanetTextureFiles, NumPlanetLayers, 256, SphereLODSegments[1] );
+	renderer.SetThreadPool( &SimulationPool );
+
+	CImg<unsigned char> frame( WindowWidth, WindowHeight, 1, 3 );
+
+	// CPU times only, there is no GL context
+	Profiler.Create( std::max( ProfilerHistory, frames ), false );
+
+	auto start = std::chrono::steady_clock::now();
+
+	SimClock.Resume();
+	for( int i = 0; i < frames; ++i )
+	{
+		Profiler.BeginFrame();
+
+		Profiler.BeginScope( "simulate" );
+		animate();
+		CreateSceneMatrices();
+		Profiler.EndScope();
+
+		Profiler.BeginScope( "render" );
+		frame.fill( 0 );
+		renderer.Render( PlanetScene, SceneProjectionMatrix, SceneViewMatrix, frame );
+		Profiler.EndScope();
+
+		Profiler.BeginScope( "save" );
+		std::string path = OffscreenTarget::FormatFramePath( headlessOutput, i );
+		try
+		{
+			frame.save( path.c_str() );
+			++written;
+		}
+		catch( CImgException& e )
+		{
+			std::cerr << "could not write " << path << ": " << e.what() << std::endl;
+		}
+		Profiler.EndScope();
+
+		Profiler.EndFrame();
+	}
+
+	PlanetScene.WaitForSimulation();
+
+	double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	std::cout << "Wrote " << written << " frames in " << seconds << " s (" << written / seconds << " frames/s)\n\n";
+
+	print_profile();
+	write_trace();
+
+	return written == frames ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main( int argc, char** argv )
 {
-	// Create and initialize the OpenGL context
-	glutInit( &argc, argv );
+	// Parse our own options first: headless mode must not open a window, or even a display
+	int simulationThreads = ThreadPool::GetDefaultNumThreads();
+	for( int i = 1; i < argc; ++i )
+	{
+		if( strcmp( argv[i], "--bodies" ) == 0 && i + 1 < argc )
+			extraBodies = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc )
+			simulationThreads = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--fps" ) == 0 && i + 1 < argc )
+		{
+			headlessFrameRate = atof( argv[++i] );
+			FrameCap.SetMaxFramesPerSecond( headlessFrameRate );
+		}
+		else if( strcmp( argv[i], "--headless" ) == 0 )
+			headless = true;
+		else if( strcmp( argv[i], "--software" ) == 0 )
+			headless = software = true;
+		else if( strcmp( argv[i], "--frames" ) == 0 && i + 1 < argc )
+			headlessFrames = atoi( argv[++i] );
+		else if( strcmp( argv[i], "--duration" ) == 0 && i + 1 < argc )
+			headlessSeconds = atof( argv[++i] );
+		else if( strcmp( argv[i], "--output" ) == 0 && i + 1 < argc )
+			headlessOutput = argv[++i];
+		else if( strcmp( argv[i], "--trace" ) == 0 && i + 1 < argc )
+			traceOutput = argv[++i];
+		else if( strcmp( argv[i], "--size" ) == 0 && i + 1 < argc )
+			sscanf( argv[++i], "%dx%d", &WindowWidth, &WindowHeight );
+	}
 
-	glutInitWindowPosition( 100, 100 );
-	glutInitWindowSize( InitWindowWidth, InitWindowHeight );
-	glutInitDisplayMode( GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH );
+	if( headlessFrameRate <= 0.0 )
+		headlessFrameRate = 60.0;
 
-	glutCreateWindow( "CSE-170 Computer Graphics" );
+	if( software )
+	{
+		SimulationPool.Create( simulationThreads );
+		PlanetScene.SetThreadPool( &SimulationPool );
+		return run_software();
+	}
 
-	std::cout << "Vendor:         " << glGetString(GL_VENDOR) << "\n";
-	std::cout << "Renderer:       " << glGetString(GL_RENDERER) << "\n";
-	std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << "\n";
-	std::cout << "GLSL Version:   " << glGetString(GL_SHADING_LANGUAGE_VERSION) << "\n\n";
+	if( headless )
+	{
+		// No GLUT at all: an EGL context and an offscreen framebuffer stand in for the window
+		if( OffscreenContext.Create( 4, 2 ) == false )
+			return EXIT_FAILURE;
+	}
+	else
+	{
+		// Create and initialize the OpenGL context
+		glutInit( &argc, argv );
 
-	// Initialize GLEW
+		glutInitWindowPosition( 100, 100 );
+		glutInitWindowSize( WindowWidth, WindowHeight );
+		glutInitDisplayMode( GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH );
+
+		glutCreateWindow( "CSE-170 Computer Graphics" );
+	}
+
+	// Initialize GLEW. A GLEW built for GLX reports a missing GLX display under EGL,
+	// after it has already loaded every GL entry point; that is fine headless.
 	GLenum ret = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if( headless && ret == GLEW_ERROR_NO_GLX_DISPLAY )
+		ret = GLEW_OK;
+#endif
 	if( ret != GLEW_OK ) {
 		std::cerr << "GLEW initialization error." << std::endl;
 		glewGetErrorString( ret );
 		return -1;
 	}
 
-	// Register callback functions
-
-	glutInitContextVersion(4, 2);
-	glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
-	glutDisplayFunc(drawScene);
-	glutIdleFunc( idle_func );
-	glutReshapeFunc( resize );
-	glutKeyboardFunc( keyboard_func );
-	glutKeyboardUpFunc( key_released );
-	glutSpecialFunc( key_special_pressed );
-	glutSpecialUpFunc( key_special_released );
-	glutMotionFunc( active_motion_func );
-	glutPassiveMotionFunc( passive_motion_func );
-
-	textureStars = loadTexture("stars.bmp");
-	texturePlanet1 = loadTexture("donut3.bmp");
-	texturePlanet2 = loadTexture("donut1.bmp");
-	texturePlanet3 = loadTexture("snail.bmp");
-	texturePlanet4 = loadTexture("pokeball.bmp");
-	glewInit();
+	if( headless == false )
+	{
+		// Register callback functions
+
+		glutInitContextVersion(4, 2);
+		glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+		glutDisplayFunc( display_func );
+		glutIdleFunc( idle_func );
+		glutReshapeFunc( resize );
+		glutKeyboardFunc( keyboard_func );
+		glutKeyboardUpFunc( key_released );
+		glutSpecialFunc( key_special_pressed );
+		glutSpecialUpFunc( key_special_released );
+		glutMotionFunc( active_motion_func );
+		glutPassiveMotionFunc( passive_motion_func );
+	}
+
+	LoaderPool.Create( std::max( 1, std::min( 4, simulationThreads ) ) );
+	Textures.Create( &LoaderPool, TextureStagingBytes );
+	texturePlanets = Textures.CreateTextureArray( PlanetTextureFiles, NumPlanetLayers, 256, 256 );
+	StarSkybox.Create( "starsInSpace.bmp", 1024, &Textures );
+	SimulationPool.Create( simulationThreads );
+	PlanetScene.SetThreadPool( &SimulationPool );
+
 	// Do program initialization
+	init();
 	setup();
-	glewInit();
+
+	if( headless )
+	{
+		if( OffscreenFrame.Create( WindowWidth, WindowHeight ) == false )
+			return EXIT_FAILURE;
+
+		OffscreenFrame.Bind();
+		resize( WindowWidth, WindowHeight );
+		return run_headless();
+	}
+
+	// Planets stand still until space is pressed
+	SimClock.Pause();
 	// Enter the main loop
 	glutMainLoop();
 
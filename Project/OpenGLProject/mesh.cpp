@@ -0,0 +1,148 @@
+#include "mesh.h"
+#include "glstate.h"
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <cstddef>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+Mesh::Mesh()
+{
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+	IndexCount = 0;
+	VertexCount = 0;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+Mesh::~Mesh()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void Mesh::Create( const std::vector<MeshVertex>& vertices, const std::vector<GLuint>& indices )
+{
+	Delete();
+
+	glGenVertexArrays( 1, &VAO );
+	GLState.BindVertexArray( VAO );
+
+	glGenBuffers( 1, &VBO );
+	glBindBuffer( GL_ARRAY_BUFFER, VBO );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( vertices[0] ) * vertices.size(), vertices.data(), GL_STATIC_DRAW );
+
+	// the index buffer binding is stored in the VAO, so it only has to be bound once here
+	glGenBuffers( 1, &IBO );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, IBO );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( indices[0] ) * indices.size(), indices.data(), GL_STATIC_DRAW );
+
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( MeshVertex ), (void*)offsetof( MeshVertex, position ) );
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( MeshVertex ), (void*)offsetof( MeshVertex, normal ) );
+	glEnableVertexAttribArray( 1 );
+	glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( MeshVertex ), (void*)offsetof( MeshVertex, texcoord ) );
+	glEnableVertexAttribArray( 2 );
+
+	GLState.BindVertexArray( 0 );
+
+	IndexCount = (GLsizei)indices.size();
+	VertexCount = (GLsizei)vertices.size();
+}
+
+// Builds a unit sphere around the Y axis. The seam column is duplicated so the texture
+// wraps cleanly, and v = 0 sits on the north pole so images load the right way up.
+void Mesh::CreateSphere( int slices, int stacks )
+{
+	std::vector<MeshVertex> vertices;
+	std::vector<GLuint> indices;
+
+	vertices.reserve( ( slices + 1 ) * ( stacks + 1 ) );
+	indices.reserve( slices * stacks * 6 );
+
+	for( int i = 0; i <= stacks; ++i )
+	{
+		float phi = (float)M_PI * (float)i / (float)stacks;
+
+		for( int j = 0; j <= slices; ++j )
+		{
+			float theta = 2.0f * (float)M_PI * (float)j / (float)slices;
+
+			MeshVertex v;
+			v.normal[0] = sinf( phi ) * sinf( theta );
+			v.normal[1] = cosf( phi );
+			v.normal[2] = sinf( phi ) * cosf( theta );
+			v.position[0] = v.normal[0];
+			v.position[1] = v.normal[1];
+			v.position[2] = v.normal[2];
+			v.texcoord[0] = (float)j / (float)slices;
+			v.texcoord[1] = (float)i / (float)stacks;
+			vertices.push_back( v );
+		}
+	}
+
+	// two counter-clockwise triangles per quad, seen from outside the sphere
+	for( int i = 0; i < stacks; ++i )
+	{
+		for( int j = 0; j < slices; ++j )
+		{
+			GLuint a = i * ( slices + 1 ) + j;
+			GLuint b = a + ( slices + 1 );
+
+			indices.push_back( a );
+			indices.push_back( b );
+			indices.push_back( b + 1 );
+
+			indices.push_back( a );
+			indices.push_back( b + 1 );
+			indices.push_back( a + 1 );
+		}
+	}
+
+	Create( vertices, indices );
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+void Mesh::Delete( void )
+{
+	if( VAO != 0 )
+	{
+		glDeleteBuffers( 1, &VBO );
+		glDeleteBuffers( 1, &IBO );
+		glDeleteVertexArrays( 1, &VAO );
+	}
+
+	VAO = 0;
+	VBO = 0;
+	IBO = 0;
+	IndexCount = 0;
+	VertexCount = 0;
+}
+
+/*=================================================================================================
+  DRAW
+=================================================================================================*/
+
+void Mesh::Bind( void ) const
+{
+	GLState.BindVertexArray( VAO );
+}
+
+void Mesh::Draw( void ) const
+{
+	GLState.BindVertexArray( VAO );
+	glDrawElements( GL_TRIANGLES, IndexCount, GL_UNSIGNED_INT, (void*)0 );
+	GLState.CountDraw();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <vector>
+
+// Interleaved vertex layout shared by every mesh:
+// attribute 0 = position, attribute 1 = normal, attribute 2 = texture coordinate
+struct MeshVertex
+{
+	GLfloat position[3];
+	GLfloat normal[3];
+	GLfloat texcoord[2];
+};
+
+class Mesh
+{
+public:
+	Mesh();
+	~Mesh();
+
+public:
+	void Create( const std::vector<MeshVertex>& vertices, const std::vector<GLuint>& indices );
+	void CreateSphere( int slices, int stacks );
+	void Delete();
+	void Bind() const;
+	void Draw() const;
+
+public:
+	GLuint  GetVAO()         const { return VAO;        }
+	GLsizei GetIndexCount()  const { return IndexCount;  }
+	GLsizei GetVertexCount() const { return VertexCount; }
+
+private:
+	GLuint VAO;
+	GLuint VBO;
+	GLuint IBO;
+	GLsizei IndexCount;
+	GLsizei VertexCount;
+};
@@ -0,0 +1,121 @@
+#include "orbitrings.h"
+#include "glstate.h"
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <vector>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+OrbitRings::OrbitRings()
+{
+	VAO = 0;
+	CircleVBO = 0;
+	RadiusVBO = 0;
+	NumPoints = 0;
+	NumRings = 0;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+OrbitRings::~OrbitRings()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+// Builds the unit circle in the XZ plane; attribute 0 = circle point, attribute 1 = ring radius
+void OrbitRings::Create( int numPoints )
+{
+	Delete();
+
+	std::vector<GLfloat> circle( 2 * numPoints );
+	for( int i = 0; i < numPoints; ++i )
+	{
+		float angle = 2.0f * (float)M_PI * (float)i / (float)numPoints;
+		circle[2 * i + 0] = cosf( angle );
+		circle[2 * i + 1] = sinf( angle );
+	}
+
+	glGenVertexArrays( 1, &VAO );
+	GLState.BindVertexArray( VAO );
+
+	glGenBuffers( 1, &CircleVBO );
+	glBindBuffer( GL_ARRAY_BUFFER, CircleVBO );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( circle[0] ) * circle.size(), circle.data(), GL_STATIC_DRAW );
+	glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof( GLfloat ), (void*)0 );
+	glEnableVertexAttribArray( 0 );
+
+	glGenBuffers( 1, &RadiusVBO );
+	glBindBuffer( GL_ARRAY_BUFFER, RadiusVBO );
+	glVertexAttribPointer( 1, 1, GL_FLOAT, GL_FALSE, sizeof( GLfloat ), (void*)0 );
+	glVertexAttribDivisor( 1, 1 );
+	glEnableVertexAttribArray( 1 );
+
+	GLState.BindVertexArray( 0 );
+
+	NumPoints = numPoints;
+	NumRings = 0;
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+void OrbitRings::Delete( void )
+{
+	if( VAO != 0 )
+	{
+		glDeleteBuffers( 1, &CircleVBO );
+		glDeleteBuffers( 1, &RadiusVBO );
+		glDeleteVertexArrays( 1, &VAO );
+	}
+
+	VAO = 0;
+	CircleVBO = 0;
+	RadiusVBO = 0;
+	NumPoints = 0;
+	NumRings = 0;
+}
+
+/*=================================================================================================
+  RADII
+=================================================================================================*/
+
+// Only needs calling when bodies are added or removed, the orbit distances never change.
+// Bodies sitting at the center have no orbit and are left out.
+void OrbitRings::SetRadii( const float* radii, int count )
+{
+	std::vector<GLfloat> rings;
+	rings.reserve( count );
+
+	for( int i = 0; i < count; ++i )
+		if( radii[i] > 0.0f )
+			rings.push_back( radii[i] );
+
+	glBindBuffer( GL_ARRAY_BUFFER, RadiusVBO );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( GLfloat ) * rings.size(), rings.data(), GL_STATIC_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	NumRings = (int)rings.size();
+}
+
+/*=================================================================================================
+  DRAW
+=================================================================================================*/
+
+void OrbitRings::Draw( void ) const
+{
+	if( NumRings == 0 )
+		return;
+
+	GLState.BindVertexArray( VAO );
+	glDrawArraysInstanced( GL_LINE_LOOP, 0, NumPoints, NumRings );
+	GLState.CountDraw();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// Orbit paths for any number of bodies. A single unit circle lives in a VBO and every
+// ring is an instance of it, scaled in shaders/orbit.vert by a per-instance radius, so
+// drawing all the rings is one instanced line-loop call with no per-frame CPU work.
+class OrbitRings
+{
+public:
+	OrbitRings();
+	~OrbitRings();
+
+public:
+	void Create( int numPoints );
+	void Delete();
+	void SetRadii( const float* radii, int count );
+	void Draw() const;
+
+public:
+	int GetNumRings()  const { return NumRings;  }
+	int GetNumPoints() const { return NumPoints; }
+
+private:
+	GLuint VAO;
+	GLuint CircleVBO;
+	GLuint RadiusVBO;
+	int NumPoints;
+	int NumRings;
+};
@@ -0,0 +1,193 @@
+#include "orbitstate.h"
+#include <cstring>
+
+#if defined(__AVX__)
+#define ORBIT_KERNEL_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define ORBIT_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+OrbitState::OrbitState()
+{
+	Count = 0;
+}
+
+/*=================================================================================================
+  BODIES
+=================================================================================================*/
+
+int OrbitState::Add( float radius, float distance, float orbit, float orbitSpeed, float spin, float spinSpeed, float layer )
+{
+	Radius.push_back( radius );
+	Distance.push_back( distance );
+	Orbit.push_back( orbit );
+	OrbitSpeed.push_back( orbitSpeed );
+	Spin.push_back( spin );
+	SpinSpeed.push_back( spinSpeed );
+	PrevOrbit.push_back( orbit );
+	PrevSpin.push_back( spin );
+	Layer.push_back( layer );
+
+	return Count++;
+}
+
+void OrbitState::Reserve( int count )
+{
+	Radius.reserve( count );
+	Distance.reserve( count );
+	Orbit.reserve( count );
+	OrbitSpeed.reserve( count );
+	Spin.reserve( count );
+	SpinSpeed.reserve( count );
+	PrevOrbit.reserve( count );
+	PrevSpin.reserve( count );
+	Layer.reserve( count );
+}
+
+void OrbitState::Clear( void )
+{
+	Radius.clear();
+	Distance.clear();
+	Orbit.clear();
+	OrbitSpeed.clear();
+	Spin.clear();
+	SpinSpeed.clear();
+	PrevOrbit.clear();
+	PrevSpin.clear();
+	Layer.clear();
+
+	Count = 0;
+}
+
+/*=================================================================================================
+  UPDATE
+=================================================================================================*/
+
+void OrbitState::Update( float steps )
+{
+	if( Count == 0 )
+		return;
+
+	PrevOrbit = Orbit;
+	PrevSpin = Spin;
+
+	IntegrateAngles( Orbit.data(), OrbitSpeed.data(), steps, Count );
+	IntegrateAngles( Spin.data(), SpinSpeed.data(), steps, Count );
+}
+
+// Writes the state src reaches after `steps` updates of `ticks` each into this state,
+// for bodies [begin, end) only. Both states must hold the same bodies; src is only read,
+// so disjoint ranges can be stepped on different threads at the same time.
+void OrbitState::StepFrom( const OrbitState& src, int steps, float ticks, int begin, int end )
+{
+	int n = end - begin;
+	if( n <= 0 )
+		return;
+
+	size_t bytes = sizeof( float ) * n;
+
+	memcpy( Orbit.data() + begin, src.Orbit.data() + begin, bytes );
+	memcpy( Spin.data() + begin, src.Spin.data() + begin, bytes );
+
+	if( steps == 0 )
+	{
+		memcpy( PrevOrbit.data() + begin, src.PrevOrbit.data() + begin, bytes );
+		memcpy( PrevSpin.data() + begin, src.PrevSpin.data() + begin, bytes );
+		return;
+	}
+
+	for( int s = 0; s < steps; ++s )
+	{
+		memcpy( PrevOrbit.data() + begin, Orbit.data() + begin, bytes );
+		memcpy( PrevSpin.data() + begin, Spin.data() + begin, bytes );
+
+		IntegrateAngles( Orbit.data() + begin, OrbitSpeed.data() + begin, ticks, n );
+		IntegrateAngles( Spin.data() + begin, SpinSpeed.data() + begin, ticks, n );
+	}
+}
+
+// Blends the previous and current angles of body i along the shorter arc, so a body
+// that just wrapped from 359 to 1 degrees does not spin back through the whole circle
+void OrbitState::GetInterpolated( int i, float alpha, float& orbit, float& spin ) const
+{
+	float dOrbit = Orbit[i] - PrevOrbit[i];
+	float dSpin = Spin[i] - PrevSpin[i];
+
+	if( dOrbit > 180.0f ) dOrbit -= 360.0f; else if( dOrbit < -180.0f ) dOrbit += 360.0f;
+	if( dSpin > 180.0f ) dSpin -= 360.0f; else if( dSpin < -180.0f ) dSpin += 360.0f;
+
+	orbit = PrevOrbit[i] + dOrbit * alpha;
+	spin = PrevSpin[i] + dSpin * alpha;
+}
+
+/*=================================================================================================
+  KERNELS
+=================================================================================================*/
+
+void IntegrateAnglesScalar( float* angles, const float* speeds, float steps, int count )
+{
+	for( int i = 0; i < count; ++i )
+	{
+		float a = angles[i] + speeds[i] * steps;
+
+		if( a >= 360.0f )
+			a -= 360.0f;
+		else if( a < 0.0f )
+			a += 360.0f;
+
+		angles[i] = a;
+	}
+}
+
+// The vector kernels wrap without branches: the compare masks select 360 or 0,
+// which is then subtracted or added to every lane.
+void IntegrateAngles( float* angles, const float* speeds, float steps, int count )
+{
+	int i = 0;
+
+#if defined(ORBIT_KERNEL_AVX)
+	const __m256 full = _mm256_set1_ps( 360.0f );
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 dt   = _mm256_set1_ps( steps );
+
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256 a = _mm256_add_ps( _mm256_loadu_ps( angles + i ), _mm256_mul_ps( _mm256_loadu_ps( speeds + i ), dt ) );
+		a = _mm256_sub_ps( a, _mm256_and_ps( _mm256_cmp_ps( a, full, _CMP_GE_OQ ), full ) );
+		a = _mm256_add_ps( a, _mm256_and_ps( _mm256_cmp_ps( a, zero, _CMP_LT_OQ ), full ) );
+		_mm256_storeu_ps( angles + i, a );
+	}
+#elif defined(ORBIT_KERNEL_SSE2)
+	const __m128 full = _mm_set1_ps( 360.0f );
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 dt   = _mm_set1_ps( steps );
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 a = _mm_add_ps( _mm_loadu_ps( angles + i ), _mm_mul_ps( _mm_loadu_ps( speeds + i ), dt ) );
+		a = _mm_sub_ps( a, _mm_and_ps( _mm_cmpge_ps( a, full ), full ) );
+		a = _mm_add_ps( a, _mm_and_ps( _mm_cmplt_ps( a, zero ), full ) );
+		_mm_storeu_ps( angles + i, a );
+	}
+#endif
+
+	// remainder that does not fill a whole vector
+	IntegrateAnglesScalar( angles + i, speeds + i, steps, count - i );
+}
+
+const char* IntegrateAnglesKernelName( void )
+{
+#if defined(ORBIT_KERNEL_AVX)
+	return "avx";
+#elif defined(ORBIT_KERNEL_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Same test as the kernels in orbitstate.cpp; other targets take the scalar path and
+// the C library's aligned allocation
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <xmmintrin.h>
+#define ORBIT_ALIGNED_MALLOC( size, alignment ) _mm_malloc( size, alignment )
+#define ORBIT_ALIGNED_FREE( p ) _mm_free( p )
+#elif defined(_WIN32)
+#include <malloc.h>
+#define ORBIT_ALIGNED_MALLOC( size, alignment ) _aligned_malloc( size, alignment )
+#define ORBIT_ALIGNED_FREE( p ) _aligned_free( p )
+#else
+inline void* OrbitAlignedMalloc( size_t size, size_t alignment )
+{
+	void* p = NULL;
+	return posix_memalign( &p, alignment, size ) == 0 ? p : NULL;
+}
+#define ORBIT_ALIGNED_MALLOC( size, alignment ) OrbitAlignedMalloc( size, alignment )
+#define ORBIT_ALIGNED_FREE( p ) free( p )
+#endif
+
+// Allocator that keeps every array on a 32-byte boundary, so whole vectors of bodies
+// never straddle a cache line in the SSE/AVX update kernels
+template <typename T>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	AlignedAllocator() {}
+	template <typename U> AlignedAllocator( const AlignedAllocator<U>& ) {}
+
+	T* allocate( size_t n )
+	{
+		void* p = ORBIT_ALIGNED_MALLOC( n * sizeof( T ), 32 );
+		if( p == NULL )
+			throw std::bad_alloc();
+		return (T*)p;
+	}
+	void deallocate( T* p, size_t ) { ORBIT_ALIGNED_FREE( p ); }
+
+	template <typename U> bool operator==( const AlignedAllocator<U>& ) const { return true;  }
+	template <typename U> bool operator!=( const AlignedAllocator<U>& ) const { return false; }
+};
+
+typedef std::vector<float, AlignedAllocator<float> > AlignedFloatArray;
+
+// Orbital state of every body, stored as a structure of arrays. Each field is its own
+// contiguous aligned array so the update touches only the data it needs, eight bodies
+// per AVX instruction. Angles are in degrees and kept inside [0, 360).
+// PrevOrbit/PrevSpin hold the angles from before the last Update(), so a renderer can
+// interpolate between the two most recent simulation steps.
+class OrbitState
+{
+public:
+	OrbitState();
+
+public:
+	int  Add( float radius, float distance, float orbit, float orbitSpeed, float spin, float spinSpeed, float layer );
+	void Reserve( int count );
+	void Clear();
+	void Update( float steps );
+	void StepFrom( const OrbitState& src, int steps, float ticks, int begin, int end );
+	void GetInterpolated( int i, float alpha, float& orbit, float& spin ) const;
+
+public:
+	int GetCount() const { return Count; }
+
+public:
+	AlignedFloatArray Radius;
+	AlignedFloatArray Distance;
+	AlignedFloatArray Orbit;
+	AlignedFloatArray OrbitSpeed;
+	AlignedFloatArray Spin;
+	AlignedFloatArray SpinSpeed;
+	AlignedFloatArray PrevOrbit;
+	AlignedFloatArray PrevSpin;
+	AlignedFloatArray Layer;
+
+private:
+	int Count;
+};
+
+//@{
+/**
+Advances angles[i] by speeds[i] * steps and wraps the result back into [0, 360).
+A single wrap is applied, so |speeds[i] * steps| must stay below 360 degrees.
+IntegrateAngles picks the widest kernel the build targets (AVX, SSE2 or scalar).
+*@param angles Angles in degrees, updated in place.
+*@param speeds Angular speed of each body in degrees per step.
+*@param steps Number of (possibly fractional) steps to advance.
+*@param count Number of bodies.
+**/
+void IntegrateAngles( float* angles, const float* speeds, float steps, int count );
+void IntegrateAnglesScalar( float* angles, const float* speeds, float steps, int count );
+//@}
+
+// Name of the kernel IntegrateAngles() dispatches to
+const char* IntegrateAnglesKernelName();
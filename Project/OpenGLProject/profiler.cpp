@@ -0,0 +1,497 @@
+#include "profiler.h"
+#include "glstate.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// Upper edges of the histogram bins in ms; the last bin has no upper edge
+static const double BinEdges[] = { 2.0, 4.0, 8.0, 12.0, 16.7, 25.0, 33.3, 50.0, 100.0 };
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+FrameProfiler::FrameProfiler()
+{
+	Enabled = true;
+	GpuTiming = false;
+	InFrame = false;
+	Origin = std::chrono::steady_clock::now();
+	Head = 0;
+	Count = 0;
+	Number = 0;
+	LastStart = -1.0;
+	QueriesUsed = 0;
+	PendingSlot[0] = PendingSlot[1] = 0;
+	PendingNumber[0] = PendingNumber[1] = -1;
+	Dropped = 0;
+
+	for( int i = 0; i < NumBins; ++i )
+		Histogram[i] = 0;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+FrameProfiler::~FrameProfiler()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+// Keeps the last historyFrames frames, at least three: the frame being drawn and the
+// two whose queries are still in flight
+void FrameProfiler::Create( int historyFrames, bool gpuTiming )
+{
+	Delete();
+
+	Frames.assign( std::max( historyFrames, 3 ), Frame() );
+	Origin = std::chrono::steady_clock::now();
+	LastStart = -1.0;
+
+	// timer queries are core since 3.3
+	GpuTiming = gpuTiming && ( GLEW_VERSION_3_3 || GLEW_ARB_timer_query );
+	if( GpuTiming )
+		glGenQueries( 2 * NumQueries, &Queries[0][0] );
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+void FrameProfiler::Delete( void )
+{
+	if( GpuTiming )
+		glDeleteQueries( 2 * NumQueries, &Queries[0][0] );
+
+	GpuTiming = false;
+	InFrame = false;
+	Frames.clear();
+	Names.clear();
+	Open.clear();
+	Head = 0;
+	Count = 0;
+	Number = 0;
+	PendingNumber[0] = PendingNumber[1] = -1;
+	Dropped = 0;
+
+	for( int i = 0; i < NumBins; ++i )
+		Histogram[i] = 0;
+}
+
+/*=================================================================================================
+  FRAMES
+=================================================================================================*/
+
+double FrameProfiler::Now( void ) const
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - Origin ).count();
+}
+
+int FrameProfiler::Intern( const std::string& name )
+{
+	for( size_t i = 0; i < Names.size(); ++i )
+		if( Names[i] == name )
+			return (int)i;
+
+	Names.push_back( name );
+	return (int)Names.size() - 1;
+}
+
+int FrameProfiler::Bin( double ms )
+{
+	int bin = 0;
+	while( bin < NumBins - 1 && ms >= BinEdges[bin] )
+		++bin;
+
+	return bin;
+}
+
+void FrameProfiler::BeginFrame( void )
+{
+	if( Enabled == false || Frames.empty() )
+		return;
+
+	if( InFrame )
+		EndFrame();
+
+	// the set this frame is about to use was last used two frames ago; read it first
+	Resolve( (int)( Number & 1 ) );
+
+	// the oldest frame makes room
+	if( Count == (int)Frames.size() )
+	{
+		--Histogram[Bin( Frames[Head].CpuMs )];
+		--Count;
+	}
+
+	Frame& frame = Frames[Head];
+	frame.Number = Number;
+	frame.Start = Now();
+	frame.CpuMs = 0.0;
+	frame.IntervalMs = LastStart >= 0.0 ? frame.Start - LastStart : 0.0;
+	frame.GpuMs = -1.0;
+	frame.DrawCalls = 0;
+	frame.StateIssued = 0;
+	frame.StateSkipped = 0;
+	frame.Scopes.clear();
+
+	LastStart = frame.Start;
+	QueriesUsed = 0;
+	Open.clear();
+	InFrame = true;
+}
+
+// Call after the frame's present, so GLState's counters already cover the whole frame
+void FrameProfiler::EndFrame( void )
+{
+	if( InFrame == false )
+		return;
+
+	while( Open.empty() == false )
+		EndScope();
+
+	Frame& frame = Frames[Head];
+	frame.CpuMs = Now() - frame.Start;
+	frame.DrawCalls = GLState.GetLastFrameDrawCalls();
+	frame.StateIssued = GLState.GetLastFrameIssued();
+	frame.StateSkipped = GLState.GetLastFrameSkipped();
+
+	if( QueriesUsed > 0 )
+	{
+		int set = (int)( Number & 1 );
+		PendingSlot[set] = Head;
+		PendingNumber[set] = Number;
+	}
+
+	++Histogram[Bin( frame.CpuMs )];
+
+	Head = ( Head + 1 ) % (int)Frames.size();
+	++Count;
+	++Number;
+	InFrame = false;
+}
+
+/*=================================================================================================
+  SCOPES
+=================================================================================================*/
+
+// Only one GL_TIME_ELAPSED query can be active at a time, so only top-level scopes are
+// timed on the GPU; nested ones get CPU times alone
+void FrameProfiler::BeginScope( const std::string& name, bool gpu )
+{
+	if( InFrame == false )
+		return;
+
+	Frame& frame = Frames[Head];
+
+	Scope scope;
+	scope.Name = Intern( name );
+	scope.Depth = (int)Open.size();
+	scope.Start = Now();
+	scope.CpuMs = 0.0;
+	scope.GpuMs = -1.0;
+	scope.Query = -1;
+
+	if( gpu && GpuTiming && Open.empty() && QueriesUsed < NumQueries )
+	{
+		scope.Query = QueriesUsed++;
+		glBeginQuery( GL_TIME_ELAPSED, Queries[Number & 1][scope.Query] );
+	}
+
+	Open.push_back( (int)frame.Scopes.size() );
+	frame.Scopes.push_back( scope );
+}
+
+void FrameProfiler::EndScope( void )
+{
+	if( InFrame == false || Open.empty() )
+		return;
+
+	Scope& scope = Frames[Head].Scopes[Open.back()];
+	Open.pop_back();
+
+	scope.CpuMs = Now() - scope.Start;
+
+	if( scope.Query >= 0 )
+		glEndQuery( GL_TIME_ELAPSED );
+}
+
+// Picks up the GPU times of the frame that last used this query set. A query whose
+// result is not available yet is dropped rather than waited for.
+void FrameProfiler::Resolve( int set )
+{
+	if( PendingNumber[set] < 0 )
+		return;
+
+	Frame& frame = Frames[PendingSlot[set]];
+
+	if( frame.Number == PendingNumber[set] )
+	{
+		double total = 0.0;
+		bool any = false;
+
+		for( size_t i = 0; i < frame.Scopes.size(); ++i )
+		{
+			Scope& scope = frame.Scopes[i];
+			if( scope.Query < 0 )
+				continue;
+
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv( Queries[set][scope.Query], GL_QUERY_RESULT_AVAILABLE, &available );
+			if( available == GL_FALSE )
+			{
+				++Dropped;
+				continue;
+			}
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v( Queries[set][scope.Query], GL_QUERY_RESULT, &nanoseconds );
+			scope.GpuMs = nanoseconds / 1e6;
+			total += scope.GpuMs;
+			any = true;
+		}
+
+		frame.GpuMs = any ? total : -1.0;
+	}
+
+	PendingNumber[set] = -1;
+}
+
+// Reads whatever is still pending, e.g. after a glFinish() at the end of a run
+void FrameProfiler::ReadBack( void )
+{
+	if( InFrame == false )
+	{
+		Resolve( 0 );
+		Resolve( 1 );
+	}
+}
+
+/*=================================================================================================
+  REPORT
+=================================================================================================*/
+
+// Averages over the kept frames: the whole frame, then every scope in the order they
+// first ran, then the histogram of CPU frame times
+std::vector<std::string> FrameProfiler::GetReport( void ) const
+{
+	std::vector<std::string> lines;
+	char line[160];
+
+	if( Count == 0 )
+	{
+		lines.push_back( "profiler: no frames yet" );
+		return lines;
+	}
+
+	int size = (int)Frames.size();
+	int first = ( Head - Count + size ) % size;
+	const Frame& last = Frames[( Head - 1 + size ) % size];
+
+	std::vector<double> cpu;
+	double cpuSum = 0.0, intervalSum = 0.0, gpuSum = 0.0;
+	int intervals = 0, gpuFrames = 0;
+
+	std::vector<double> scopeCpu( Names.size(), 0.0 ), scopeGpu( Names.size(), 0.0 );
+	std::vector<int> scopeCount( Names.size(), 0 ), scopeGpuCount( Names.size(), 0 ), scopeDepth( Names.size(), 0 );
+	std::vector<int> order;
+
+	for( int i = 0; i < Count; ++i )
+	{
+		const Frame& frame = Frames[( first + i ) % size];
+
+		cpu.push_back( frame.CpuMs );
+		cpuSum += frame.CpuMs;
+
+		if( frame.IntervalMs > 0.0 )
+		{
+			intervalSum += frame.IntervalMs;
+			++intervals;
+		}
+
+		if( frame.GpuMs >= 0.0 )
+		{
+			gpuSum += frame.GpuMs;
+			++gpuFrames;
+		}
+
+		for( size_t s = 0; s < frame.Scopes.size(); ++s )
+		{
+			const Scope& scope = frame.Scopes[s];
+
+			if( scopeCount[scope.Name] == 0 )
+			{
+				order.push_back( scope.Name );
+				scopeDepth[scope.Name] = scope.Depth;
+			}
+
+			scopeCpu[scope.Name] += scope.CpuMs;
+			++scopeCount[scope.Name];
+
+			if( scope.GpuMs >= 0.0 )
+			{
+				scopeGpu[scope.Name] += scope.GpuMs;
+				++scopeGpuCount[scope.Name];
+			}
+		}
+	}
+
+	std::sort( cpu.begin(), cpu.end() );
+	double p50 = cpu[( cpu.size() - 1 ) / 2];
+	double p99 = cpu[std::min( cpu.size() - 1, ( cpu.size() * 99 ) / 100 )];
+
+	snprintf( line, sizeof( line ), "cpu frame  %6.2f ms avg  %6.2f p50  %6.2f p99  %6.1f fps", cpuSum / Count, p50, p99, intervals > 0 ? 1000.0 * intervals / intervalSum : 0.0 );
+	lines.push_back( line );
+
+	if( GpuTiming )
+		snprintf( line, sizeof( line ), "gpu frame  %6.2f ms avg  (%lld results dropped)", gpuFrames > 0 ? gpuSum / gpuFrames : 0.0, Dropped );
+	else
+		snprintf( line, sizeof( line ), "gpu frame  not timed" );
+	lines.push_back( line );
+
+	snprintf( line, sizeof( line ), "last frame %lld draw calls, %lld state changes, %lld skipped", last.DrawCalls, last.StateIssued, last.StateSkipped );
+	lines.push_back( line );
+
+	lines.push_back( "" );
+	lines.push_back( "scope                        cpu ms    gpu ms" );
+
+	for( size_t i = 0; i < order.size(); ++i )
+	{
+		int name = order[i];
+		std::string label = std::string( 2 * scopeDepth[name], ' ' ) + Names[name];
+		label.resize( 26, ' ' );
+
+		if( scopeGpuCount[name] > 0 )
+			snprintf( line, sizeof( line ), "%s %9.3f %9.3f", label.c_str(), scopeCpu[name] / scopeCount[name], scopeGpu[name] / scopeGpuCount[name] );
+		else
+			snprintf( line, sizeof( line ), "%s %9.3f         -", label.c_str(), scopeCpu[name] / scopeCount[name] );
+		lines.push_back( line );
+	}
+
+	lines.push_back( "" );
+	snprintf( line, sizeof( line ), "cpu frame times, last %d frames", Count );
+	lines.push_back( line );
+
+	int most = *std::max_element( Histogram, Histogram + NumBins );
+
+	for( int bin = 0; bin < NumBins; ++bin )
+	{
+		std::string bar( most > 0 ? ( 30 * Histogram[bin] + most - 1 ) / most : 0, '#' );
+
+		if( bin < NumBins - 1 )
+			snprintf( line, sizeof( line ), "  < %5.1f ms %-30s %d", BinEdges[bin], bar.c_str(), Histogram[bin] );
+		else
+			snprintf( line, sizeof( line ), " >= %5.1f ms %-30s %d", BinEdges[bin - 1], bar.c_str(), Histogram[bin] );
+		lines.push_back( line );
+	}
+
+	return lines;
+}
+
+// Text in the window's lower-left based pixel coordinates, starting with the top line
+// at (x, y). Needs a compatibility context and glutInit(), for the bitmap font.
+void FrameProfiler::DrawOverlay( int x, int y ) const
+{
+	std::vector<std::string> lines = GetReport();
+
+	// bitmap text goes through the fixed-function pipeline, which lighting would tint
+	GLboolean lighting = glIsEnabled( GL_LIGHTING );
+	glDisable( GL_LIGHTING );
+	GLState.UseProgram( 0 );
+	GLState.Disable( GL_DEPTH_TEST );
+
+	glColor3f( 1.0f, 1.0f, 0.4f );
+	for( size_t i = 0; i < lines.size(); ++i )
+	{
+		glWindowPos2i( x, y - 13 * (int)i );
+		glutBitmapString( GLUT_BITMAP_8_BY_13, (const unsigned char*)lines[i].c_str() );
+	}
+
+	GLState.Enable( GL_DEPTH_TEST );
+	if( lighting )
+		glEnable( GL_LIGHTING );
+}
+
+/*=================================================================================================
+  TRACE
+=================================================================================================*/
+
+static std::string trace_string( const std::string& text )
+{
+	std::string out = "\"";
+
+	for( size_t i = 0; i < text.size(); ++i )
+	{
+		if( text[i] == '"' || text[i] == '\\' )
+			out += '\\';
+		out += text[i];
+	}
+
+	return out + "\"";
+}
+
+// Frames and CPU scopes go on one track, GPU times on a second one. Timer queries
+// only measure durations, so each GPU slice starts where its scope started on the CPU,
+// or where the previous slice ended if that is later.
+bool FrameProfiler::WriteTrace( const std::string& path ) const
+{
+	std::ofstream out( path.c_str() );
+	if( out.is_open() == false )
+	{
+		std::cerr << "profiler: could not write " << path << std::endl;
+		return false;
+	}
+
+	char event[512];
+	int size = (int)Frames.size();
+	int first = Count > 0 ? ( Head - Count + size ) % size : 0;
+	double gpuCursor = 0.0;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	for( int i = 0; i < Count; ++i )
+	{
+		const Frame& frame = Frames[( first + i ) % size];
+
+		snprintf( event, sizeof( event ), ",\n{\"name\":\"frame %lld\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,"
+			"\"args\":{\"draw calls\":%lld,\"state changes\":%lld,\"state changes skipped\":%lld,\"gpu ms\":%.3f}}",
+			frame.Number, 1000.0 * frame.Start, 1000.0 * frame.CpuMs, frame.DrawCalls, frame.StateIssued, frame.StateSkipped, frame.GpuMs );
+		out << event;
+
+		snprintf( event, sizeof( event ), ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"draw calls\":%lld,\"state changes\":%lld}}",
+			1000.0 * frame.Start, frame.DrawCalls, frame.StateIssued );
+		out << event;
+
+		for( size_t s = 0; s < frame.Scopes.size(); ++s )
+		{
+			const Scope& scope = frame.Scopes[s];
+			std::string name = trace_string( Names[scope.Name] );
+
+			snprintf( event, sizeof( event ), ",\n{\"name\":%s,\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				name.c_str(), 1000.0 * scope.Start, 1000.0 * scope.CpuMs );
+			out << event;
+
+			if( scope.GpuMs >= 0.0 )
+			{
+				double start = std::max( scope.Start, gpuCursor );
+				gpuCursor = start + scope.GpuMs;
+
+				snprintf( event, sizeof( event ), ",\n{\"name\":%s,\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+					name.c_str(), 1000.0 * start, 1000.0 * scope.GpuMs );
+				out << event;
+			}
+		}
+	}
+
+	out << "\n]}\n";
+
+	return out.good();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Where the time of a frame goes, on the CPU and the GPU. Every scope is timed on the
+// CPU; top-level scopes (the frame graph's passes) also get a GL_TIME_ELAPSED query.
+// Queries come from two sets used on alternate frames, and a set is read back just
+// before it is reused, two frames later, when the GPU is long done with it; reading
+// never waits on the GPU, a result that is still not there is dropped instead. The last
+// frames are kept with the draw calls and state changes GLState counted for them, and a
+// histogram of their CPU times. They can be drawn as an overlay or written out in the
+// Chrome trace format (chrome://tracing or ui.perfetto.dev).
+class FrameProfiler
+{
+public:
+	FrameProfiler();
+	~FrameProfiler();
+
+public:
+	// gpuTiming needs a current GL context; without it only CPU times are taken
+	void Create( int historyFrames, bool gpuTiming );
+	void Delete();
+	void SetEnabled( bool enabled ) { Enabled = enabled; }
+
+	void BeginFrame();
+	void EndFrame();
+	void BeginScope( const std::string& name, bool gpu = true );
+	void EndScope();
+	void ReadBack();
+
+	std::vector<std::string> GetReport() const;
+	void DrawOverlay( int x, int y ) const;
+	bool WriteTrace( const std::string& path ) const;
+
+public:
+	bool IsEnabled()   const { return Enabled;   }
+	bool IsGpuTiming() const { return GpuTiming; }
+	int  GetNumFrames() const { return Count; }
+	long long GetNumDropped() const { return Dropped; }
+
+private:
+	static const int NumQueries = 32; // per set, the most GPU-timed scopes in one frame
+	static const int NumBins = 10;
+
+	struct Scope
+	{
+		int Name;
+		int Depth;
+		double Start;  // ms since Create()
+		double CpuMs;
+		double GpuMs;  // -1 when not measured
+		int Query;     // index into the frame's query set, -1 for none
+	};
+
+	struct Frame
+	{
+		long long Number;
+		double Start;
+		double CpuMs;
+		double IntervalMs; // since the previous frame began
+		double GpuMs;      // sum of the top-level scopes, -1 until read back
+		long long DrawCalls;
+		long long StateIssued;
+		long long StateSkipped;
+		std::vector<Scope> Scopes;
+	};
+
+	double Now() const;
+	int Intern( const std::string& name );
+	void Resolve( int set );
+	static int Bin( double ms );
+
+	bool Enabled;
+	bool GpuTiming;
+	bool InFrame;
+	std::chrono::steady_clock::time_point Origin;
+
+	std::vector<Frame> Frames; // ring buffer of the last frames, Head is the next one
+	int Head;
+	int Count;
+	long long Number;
+	double LastStart;
+
+	std::vector<std::string> Names;
+	std::vector<int> Open;
+
+	GLuint Queries[2][NumQueries];
+	int QueriesUsed;
+	int PendingSlot[2];
+	long long PendingNumber[2];
+	long long Dropped;
+
+	int Histogram[NumBins];
+};
+
+// Times the enclosing block as one scope
+class ProfileScope
+{
+public:
+	ProfileScope( FrameProfiler& profiler, const std::string& name, bool gpu = true ) : Profiler( profiler ) { Profiler.BeginScope( name, gpu ); }
+	~ProfileScope() { Profiler.EndScope(); }
+
+private:
+	FrameProfiler& Profiler;
+};
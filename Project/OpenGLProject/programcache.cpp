@@ -0,0 +1,204 @@
+#include "programcache.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#if defined( _WIN32 )
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Start of every cache file, followed by the key, the binary format and the binary size
+static const char CacheMagic[4] = { 'O', 'P', 'B', '1' };
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+ProgramBinaryCache::ProgramBinaryCache()
+{
+	Enabled = false;
+	Hits = 0;
+	Misses = 0;
+	Rejected = 0;
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void ProgramBinaryCache::Create( const std::string& directory )
+{
+	Delete();
+
+	GLint formats = 0;
+	if( GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary )
+		glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+
+	if( formats == 0 )
+		return;
+
+	Directory = directory;
+	Driver = std::string( (const char*)glGetString( GL_VENDOR ) ) + "\n" +
+	         std::string( (const char*)glGetString( GL_RENDERER ) ) + "\n" +
+	         std::string( (const char*)glGetString( GL_VERSION ) );
+
+	// an existing directory is fine; one that cannot be made only costs failed writes
+#if defined( _WIN32 )
+	_mkdir( Directory.c_str() );
+#else
+	mkdir( Directory.c_str(), 0755 );
+#endif
+
+	Enabled = true;
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+void ProgramBinaryCache::Delete( void )
+{
+	Enabled = false;
+	Directory = "";
+	Driver = "";
+	Hits = 0;
+	Misses = 0;
+	Rejected = 0;
+}
+
+/*=================================================================================================
+  KEYS
+=================================================================================================*/
+
+// 64-bit FNV-1a over the driver strings, the defines and every source, each followed by
+// a 0 byte so that moving text from one part to the next changes the key
+uint64_t ProgramBinaryCache::MakeKey( const std::vector<std::string>& sources, const std::string& defines ) const
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	auto add = [&hash]( const std::string& text ) {
+		for( size_t i = 0; i < text.size(); ++i )
+			hash = ( hash ^ (unsigned char)text[i] ) * 1099511628211ull;
+		hash = hash * 1099511628211ull;
+	};
+
+	add( Driver );
+	add( defines );
+	for( size_t i = 0; i < sources.size(); ++i )
+		add( sources[i] );
+
+	return hash;
+}
+
+std::string ProgramBinaryCache::GetPath( uint64_t key ) const
+{
+	char name[32];
+	snprintf( name, sizeof( name ), "%016llx.bin", (unsigned long long)key );
+	return Directory + "/" + name;
+}
+
+/*=================================================================================================
+  LOAD
+=================================================================================================*/
+
+// True when program is linked from the cached binary
+bool ProgramBinaryCache::Load( GLuint program, uint64_t key )
+{
+	if( Enabled == false )
+		return false;
+
+	std::string path = GetPath( key );
+	std::ifstream file( path, std::ios::binary );
+	if( file.is_open() == false )
+	{
+		++Misses;
+		return false;
+	}
+
+	char magic[4];
+	uint64_t storedKey = 0;
+	uint32_t format = 0, size = 0;
+	file.read( magic, sizeof( magic ) );
+	file.read( (char*)&storedKey, sizeof( storedKey ) );
+	file.read( (char*)&format, sizeof( format ) );
+	file.read( (char*)&size, sizeof( size ) );
+
+	std::vector<char> binary;
+	bool valid = file.good() && std::equal( magic, magic + 4, CacheMagic ) && storedKey == key && size > 0;
+	if( valid )
+	{
+		binary.resize( size );
+		file.read( binary.data(), size );
+		valid = file.gcount() == (std::streamsize)size;
+	}
+	file.close();
+
+	GLint status = GL_FALSE;
+	if( valid )
+	{
+		glProgramBinary( program, (GLenum)format, binary.data(), (GLsizei)size );
+		glGetProgramiv( program, GL_LINK_STATUS, &status );
+	}
+
+	if( status != GL_TRUE )
+	{
+		std::remove( path.c_str() );
+		++Rejected;
+		return false;
+	}
+
+	++Hits;
+	return true;
+}
+
+/*=================================================================================================
+  STORE
+=================================================================================================*/
+
+// program must be linked, after GL_PROGRAM_BINARY_RETRIEVABLE_HINT was set on it
+void ProgramBinaryCache::Store( GLuint program, uint64_t key )
+{
+	if( Enabled == false )
+		return;
+
+	GLint status = GL_FALSE, length = 0;
+	glGetProgramiv( program, GL_LINK_STATUS, &status );
+	glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length );
+	if( status != GL_TRUE || length <= 0 )
+		return;
+
+	std::vector<char> binary( length );
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary( program, length, &written, &format, binary.data() );
+	if( written <= 0 )
+		return;
+
+	// written under another name first, so a crash never leaves half a binary behind
+	std::string path = GetPath( key );
+	std::string temporary = path + ".tmp";
+
+	std::ofstream file( temporary, std::ios::binary );
+	if( file.is_open() == false )
+		return;
+
+	uint32_t format32 = format, size = (uint32_t)written;
+	file.write( CacheMagic, sizeof( CacheMagic ) );
+	file.write( (const char*)&key, sizeof( key ) );
+	file.write( (const char*)&format32, sizeof( format32 ) );
+	file.write( (const char*)&size, sizeof( size ) );
+	file.write( binary.data(), written );
+	file.close();
+
+	if( file.good() == false )
+	{
+		std::remove( temporary.c_str() );
+		return;
+	}
+
+	std::remove( path.c_str() );
+	if( std::rename( temporary.c_str(), path.c_str() ) != 0 )
+		std::remove( temporary.c_str() );
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked programs saved to disk with glGetProgramBinary() and restored with
+// glProgramBinary(), so a launch that has seen the same shaders before skips the
+// compiler. A binary is only valid for the driver that made it, so the key hashes the
+// vendor, renderer and version strings along with the sources and their defines. The
+// driver may still reject a binary, e.g. after an update that kept its version string;
+// Load() then deletes the file and the caller compiles from source.
+class ProgramBinaryCache
+{
+public:
+	ProgramBinaryCache();
+
+public:
+	// Needs a current GL context. Disabled when the driver offers no binary formats.
+	void Create( const std::string& directory );
+	void Delete();
+
+	uint64_t MakeKey( const std::vector<std::string>& sources, const std::string& defines ) const;
+	bool Load( GLuint program, uint64_t key );
+	void Store( GLuint program, uint64_t key );
+
+public:
+	bool IsEnabled() const { return Enabled; }
+	int GetNumHits()     const { return Hits;     }
+	int GetNumMisses()   const { return Misses;   }
+	int GetNumRejected() const { return Rejected; }
+
+private:
+	std::string GetPath( uint64_t key ) const;
+
+	bool Enabled;
+	std::string Directory;
+	std::string Driver; // vendor, renderer and version, part of every key
+	int Hits;
+	int Misses;
+	int Rejected;
+};
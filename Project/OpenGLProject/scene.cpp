@@ -0,0 +1,294 @@
+#include "scene.h"
+#include "glstate.h"
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+Scene::Scene()
+{
+	InstanceVBO = 0;
+	InstanceCapacity = 0;
+	BaseInstance = false;
+	Front = 0;
+	FrontAlpha = 0.0f;
+	BackAlpha = 0.0f;
+	Pool = NULL;
+	Culling = true;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+Scene::~Scene()
+{
+	WaitForSimulation();
+	Delete();
+}
+
+/*=================================================================================================
+  BODIES
+=================================================================================================*/
+
+void Scene::AddPlanet( const Planet& planet )
+{
+	WaitForSimulation();
+
+	for( int i = 0; i < 2; ++i )
+		States[i].Add( planet.radius, planet.distance, planet.orbit, planet.orbitSpeed, planet.axisAnimate, planet.axisSpeed, planet.textureLayer );
+}
+
+// Scatters small bodies through a belt outside the named planets. Orbit speed falls off
+// with the square root of the distance, anchored to the innermost planet (4.74 at 7).
+void Scene::AddRandomPlanets( int count, int numLayers, unsigned int seed )
+{
+	std::mt19937 rng( seed );
+	std::uniform_real_distribution<float> distance( 20.0f, 60.0f );
+	std::uniform_real_distribution<float> radius( 0.1f, 0.6f );
+	std::uniform_real_distribution<float> angle( 0.0f, 360.0f );
+	std::uniform_int_distribution<int> layer( 0, numLayers > 0 ? numLayers - 1 : 0 );
+
+	WaitForSimulation();
+
+	for( int i = 0; i < 2; ++i )
+		States[i].Reserve( States[i].GetCount() + count );
+
+	for( int i = 0; i < count; ++i )
+	{
+		float d = distance( rng );
+		AddPlanet( Planet( radius( rng ), d, angle( rng ), 4.74f * sqrtf( 7.0f / d ), angle( rng ), (float)layer( rng ) ) );
+	}
+}
+
+void Scene::Clear( void )
+{
+	WaitForSimulation();
+
+	States[0].Clear();
+	States[1].Clear();
+	Instances.clear();
+	BodyLods.clear();
+	Bounds.Clear();
+}
+
+// Bodies start over without a level, so the next Upload() picks one from scratch
+void Scene::SetLodSelector( const LodSelector& selector )
+{
+	Lod = selector;
+	BodyLods.clear();
+}
+
+/*=================================================================================================
+  SIMULATION
+=================================================================================================*/
+
+// Called once per frame by the render thread. Publishes the state the workers finished
+// during the last frame, then starts stepping it on the pool into the other buffer.
+// The state being drawn is therefore always one frame behind the clock, along with the
+// interpolation factor that belongs to it.
+void Scene::Simulate( int steps, float ticks, float alpha )
+{
+	WaitForSimulation();
+
+	Front = 1 - Front;
+	FrontAlpha = BackAlpha;
+	BackAlpha = alpha;
+
+	const OrbitState* src = &States[Front];
+	OrbitState* dst = &States[1 - Front];
+
+	ThreadPool::RangeFunc step = [src, dst, steps, ticks]( int begin, int end ) {
+		dst->StepFrom( *src, steps, ticks, begin, end );
+	};
+
+	// 16k bodies per task keeps each range's arrays inside the L2 cache
+	if( Pool != NULL )
+		Pool->Dispatch( src->GetCount(), 16384, step );
+	else
+		step( 0, src->GetCount() );
+}
+
+void Scene::WaitForSimulation( void )
+{
+	if( Pool != NULL )
+		Pool->Wait();
+}
+
+/*=================================================================================================
+  BUFFERS
+=================================================================================================*/
+
+void Scene::CreateBuffers( void )
+{
+	if( InstanceVBO == 0 )
+		glGenBuffers( 1, &InstanceVBO );
+
+	InstanceCapacity = 0;
+	BaseInstance = GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+}
+
+// Adds the per-instance attributes to a mesh VAO, so any level of detail can be drawn
+// straight from the shared instance buffer
+void Scene::AttachInstanceAttributes( const Mesh& mesh )
+{
+	mesh.Bind();
+	glBindBuffer( GL_ARRAY_BUFFER, InstanceVBO );
+
+	SetInstancePointers( 0 );
+	glVertexAttribDivisor( 3, 1 );
+	glEnableVertexAttribArray( 3 );
+	glVertexAttribDivisor( 4, 1 );
+	glEnableVertexAttribArray( 4 );
+
+	GLState.BindVertexArray( 0 );
+}
+
+// Points the bound VAO's instance attributes at the instance buffer, offset bytes in
+void Scene::SetInstancePointers( GLintptr offset ) const
+{
+	glVertexAttribPointer( 3, 4, GL_FLOAT, GL_FALSE, sizeof( PlanetInstance ), (void*)( offset + offsetof( PlanetInstance, orbit ) ) );
+	glVertexAttribPointer( 4, 1, GL_FLOAT, GL_FALSE, sizeof( PlanetInstance ), (void*)( offset + offsetof( PlanetInstance, layer ) ) );
+}
+
+void Scene::Delete( void )
+{
+	if( InstanceVBO != 0 )
+		glDeleteBuffers( 1, &InstanceVBO );
+
+	InstanceVBO = 0;
+	InstanceCapacity = 0;
+}
+
+// Packs the visible bodies into the instance array and streams it to the GPU. Bodies are
+// blended between their last two simulation steps (see SimulationClock::GetAlpha) and the
+// bounding hierarchy is refit to those positions, so culling tests exactly what is drawn.
+// Every visible body gets a level of detail from its projected radius. The array is
+// grouped by level (a counting sort, so the order within a level stays stable) and every
+// group is drawn with its own mesh.
+// The buffer is orphaned each frame so the driver never waits on last frame's draw.
+void Scene::Upload( const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, float viewportHeight )
+{
+	const OrbitState& state = States[Front];
+	int count = state.GetCount();
+	int numLevels = Lod.GetNumLevels();
+
+	if( (int)BodyLods.size() != count )
+		BodyLods.assign( count, 0xFF ); // no level yet
+
+	Unsorted.resize( count );
+	BodyX.resize( count );
+	BodyY.assign( count, 0.0f );
+	BodyZ.resize( count );
+
+	// a body sits at (d cos a, 0, -d sin a), see rotateY() in instanced.vert
+	const float toRadians = 3.14159265f / 180.0f;
+
+	for( int i = 0; i < count; ++i )
+	{
+		PlanetInstance& instance = Unsorted[i];
+
+		state.GetInterpolated( i, FrontAlpha, instance.orbit, instance.spin );
+		instance.distance = state.Distance[i];
+		instance.radius   = state.Radius[i];
+		instance.layer    = state.Layer[i];
+
+		float angle = instance.orbit * toRadians;
+		BodyX[i] =  instance.distance * cosf( angle );
+		BodyZ[i] = -instance.distance * sinf( angle );
+	}
+
+	Visible.clear();
+
+	if( Culling )
+	{
+		Frustum frustum;
+		frustum.Extract( projectionMatrix * viewMatrix );
+
+		Bounds.Refit( BodyX.data(), BodyY.data(), BodyZ.data(), state.Radius.data(), count );
+		Bounds.Query( frustum, BodyX.data(), BodyY.data(), BodyZ.data(), state.Radius.data(), Visible );
+	}
+	else
+	{
+		Visible.resize( count );
+		for( int i = 0; i < count; ++i )
+			Visible[i] = i;
+	}
+
+	int numVisible = (int)Visible.size();
+
+	Instances.resize( numVisible );
+	LodFirst.assign( numLevels, 0 );
+	LodCounts.assign( numLevels, 0 );
+
+	float projectionScale = projectionMatrix[1][1];
+
+	for( int v = 0; v < numVisible; ++v )
+	{
+		int i = Visible[v];
+		float depth = -( viewMatrix[0][2] * BodyX[i] + viewMatrix[2][2] * BodyZ[i] + viewMatrix[3][2] );
+		float projected = LodSelector::ProjectedRadius( depth, state.Radius[i], projectionScale, viewportHeight );
+
+		int level = Lod.Select( BodyLods[i] == 0xFF ? -1 : BodyLods[i], projected );
+		BodyLods[i] = (unsigned char)level;
+		++LodCounts[level];
+	}
+
+	for( int level = 1; level < numLevels; ++level )
+		LodFirst[level] = LodFirst[level - 1] + LodCounts[level - 1];
+
+	std::vector<int> next( LodFirst );
+
+	for( int v = 0; v < numVisible; ++v )
+		Instances[next[BodyLods[Visible[v]]]++] = Unsorted[Visible[v]];
+
+	GLsizeiptr size = sizeof( PlanetInstance ) * Instances.size();
+
+	glBindBuffer( GL_ARRAY_BUFFER, InstanceVBO );
+
+	if( size > InstanceCapacity )
+		InstanceCapacity = size;
+
+	glBufferData( GL_ARRAY_BUFFER, InstanceCapacity, NULL, GL_STREAM_DRAW );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, size, Instances.data() );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+/*=================================================================================================
+  DRAW
+=================================================================================================*/
+
+// One draw call per level of detail, meshes[0] being the finest. Every mesh must have had
+// AttachInstanceAttributes() called; the base instance selects the level's range of the
+// instance buffer. Without base instances the range is selected by moving the instance
+// attribute pointers to its start instead, which costs a little validation per draw.
+// Levels past numMeshes fall back to the coarsest mesh given.
+void Scene::Draw( const Mesh* meshes, int numMeshes ) const
+{
+	if( Instances.empty() || numMeshes <= 0 )
+		return;
+
+	for( int level = 0; level < (int)LodCounts.size(); ++level )
+	{
+		if( LodCounts[level] == 0 )
+			continue;
+
+		const Mesh& mesh = meshes[level < numMeshes ? level : numMeshes - 1];
+
+		mesh.Bind();
+
+		if( BaseInstance )
+			glDrawElementsInstancedBaseInstance( GL_TRIANGLES, mesh.GetIndexCount(), GL_UNSIGNED_INT, (void*)0, LodCounts[level], LodFirst[level] );
+		else
+		{
+			glBindBuffer( GL_ARRAY_BUFFER, InstanceVBO );
+			SetInstancePointers( (GLintptr)LodFirst[level] * sizeof( PlanetInstance ) );
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+			glDrawElementsInstanced( GL_TRIANGLES, mesh.GetIndexCount(), GL_UNSIGNED_INT, (void*)0, LodCounts[level] );
+		}
+		GLState.CountDraw();
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "culling.h"
+#include "lod.h"
+#include "mesh.h"
+#include "orbitstate.h"
+#include "threadpool.h"
+
+class Planet
+{
+public:
+	float radius;
+	float distance;
+	float orbit;
+	float orbitSpeed;
+	float axisAnimate;
+	float axisSpeed;
+	float textureLayer;
+
+	Planet(float planetRadius, float planetDistance, float planetOrbit, float planetOrbitSpeed, float planetAxisAnimate, float planetTextureLayer = 0, float planetAxisSpeed = 10.0) {
+		radius = planetRadius;
+		distance = planetDistance;
+		orbit = planetOrbit;
+		orbitSpeed = planetOrbitSpeed;
+		axisAnimate = planetAxisAnimate;
+		axisSpeed = planetAxisSpeed;
+		textureLayer = planetTextureLayer;
+	}
+};
+
+// Per-instance record streamed to shaders/instanced.vert, one per body.
+// Attribute 3 = (orbit, distance, radius, spin), attribute 4 = texture layer.
+struct PlanetInstance
+{
+	GLfloat orbit;
+	GLfloat distance;
+	GLfloat radius;
+	GLfloat spin;
+	GLfloat layer;
+};
+
+class Scene
+{
+public:
+	Scene();
+	~Scene();
+
+public:
+	void AddPlanet( const Planet& planet );
+	void AddRandomPlanets( int count, int numLayers, unsigned int seed );
+	void Clear();
+	void SetThreadPool( ThreadPool* pool ) { Pool = pool; }
+	void SetLodSelector( const LodSelector& selector );
+	void SetCulling( bool enabled ) { Culling = enabled; }
+	void Simulate( int steps, float ticks, float alpha );
+	void WaitForSimulation();
+
+	void CreateBuffers();
+	void AttachInstanceAttributes( const Mesh& mesh );
+	void Delete();
+	void Upload( const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, float viewportHeight );
+	void Draw( const Mesh* meshes, int numMeshes ) const;
+
+public:
+	int GetNumPlanets() const { return States[Front].GetCount(); }
+	const OrbitState& GetState() const { return States[Front]; }
+	float GetAlpha() const { return FrontAlpha; } // interpolation factor that goes with GetState()
+	bool IsCulling() const { return Culling; }
+	int GetNumVisible() const { return (int)Instances.size(); }
+	int GetNumBVHRebuilds() const { return Bounds.GetNumRebuilds(); }
+	int GetLodCount( int level ) const { return level < (int)LodCounts.size() ? LodCounts[level] : 0; }
+
+private:
+	// Double-buffered simulation state: the render thread only reads States[Front] while
+	// the pool writes the next step into the other buffer. They swap in Simulate(), once
+	// per frame, after the workers are done, so reads never need a lock.
+	OrbitState States[2];
+	int Front;
+	float FrontAlpha;
+	float BackAlpha;
+	ThreadPool* Pool;
+	std::vector<PlanetInstance> Instances;
+
+	// World-space centers of the bodies as drawn this frame and the hierarchy over them
+	// that finds the ones inside the view frustum
+	BodyBVH Bounds;
+	std::vector<float> BodyX;
+	std::vector<float> BodyY;
+	std::vector<float> BodyZ;
+	std::vector<int> Visible;
+	bool Culling;
+
+	// Level chosen for each body last drawn, which the selector's hysteresis works from.
+	// Instances are uploaded grouped by level; LodFirst/LodCounts give each group's range.
+	LodSelector Lod;
+	std::vector<unsigned char> BodyLods;
+	std::vector<PlanetInstance> Unsorted;
+	std::vector<int> LodFirst;
+	std::vector<int> LodCounts;
+
+	void SetInstancePointers( GLintptr offset ) const;
+
+	GLuint InstanceVBO;
+	GLsizeiptr InstanceCapacity;
+	bool BaseInstance; // GL 4.2 or GL_ARB_base_instance; otherwise Draw() moves the attribute pointers
+};
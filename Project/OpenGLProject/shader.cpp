@@ -1,4 +1,5 @@
 #include "shader.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -11,6 +12,7 @@ Shader::Shader()
 	ID = 0;
 	Type = GL_INVALID_ENUM;
 	Path = "";
+	Defines = "";
 }
 
 Shader::Shader( std::string shaderPath, GLenum shaderType )
@@ -31,14 +33,15 @@ Shader::~Shader()
   CREATE
 =================================================================================================*/
 
-void Shader::Create( std::string shaderPath, GLenum shaderType )
+void Shader::Create( std::string shaderPath, GLenum shaderType, std::string defines, bool checkStatus )
 {
 	ID = glCreateShader( shaderType );
 
 	Type = shaderType;
 	Path = shaderPath;
+	Defines = defines;
 
-	Load();
+	Load( checkStatus );
 }
 
 /*=================================================================================================
@@ -52,28 +55,24 @@ void Shader::Delete( void )
 	ID = 0;
 	Type = GL_INVALID_ENUM;
 	Path = "";
+	Defines = "";
+	Files.clear();
 }
 
 /*=================================================================================================
   LOAD
 =================================================================================================*/
 
-void Shader::Load( void )
+void Shader::Load( bool checkStatus )
 {
 	if( ID == 0 )
 		return;
 
-	std::ifstream srcFile( Path );
-	std::string shaderSrc, line;
+	std::string shaderSrc;
 
-	if( srcFile.is_open() == true )
+	if( ReadSource( Path, shaderSrc, &Files ) == true )
 	{
-		while( std::getline( srcFile, line ) )
-		{
-			shaderSrc += line;
-			shaderSrc += '\n';
-		}
-		srcFile.close();
+		InsertDefines( shaderSrc, Defines );
 
 		const char* src = shaderSrc.c_str();
 
@@ -81,14 +80,128 @@ void Shader::Load( void )
 
 		glCompileShader( ID );
 
-		// If the shader didn't compile successfully, print log
-		if( GetCompileStatus() == 0 )
-			std::cerr << Path << std::endl << GetInfoLog() << std::endl;
+		// asking for the status waits for the compiler to finish
+		if( checkStatus == true )
+			CheckCompileStatus();
 	}
 	else
 		std::cerr << "Unable to open shader file: " << Path << std::endl;
 }
 
+void Shader::CheckCompileStatus( void ) const
+{
+	// If the shader didn't compile successfully, print log
+	if( GetCompileStatus() == 0 )
+	{
+		std::cerr << Path << std::endl;
+		for( size_t i = 1; i < Files.size(); ++i )
+			std::cerr << "  " << i << ": " << Files[i] << std::endl;
+		if( Defines.empty() == false )
+			std::cerr << Defines;
+		std::cerr << GetInfoLog() << std::endl;
+	}
+}
+
+// Name of the file in a line like: #include "name"
+static bool ParseInclude( const std::string& line, std::string& name )
+{
+	size_t pos = line.find_first_not_of( " \t" );
+	if( pos == std::string::npos || line[pos] != '#' )
+		return false;
+
+	pos = line.find_first_not_of( " \t", pos + 1 );
+	if( pos == std::string::npos || line.compare( pos, 7, "include" ) != 0 )
+		return false;
+
+	size_t first = line.find( '"', pos + 7 );
+	size_t last = first == std::string::npos ? first : line.find( '"', first + 1 );
+	if( last == std::string::npos )
+		return false;
+
+	name = line.substr( first + 1, last - first - 1 );
+	return true;
+}
+
+static bool AppendFile( const std::string& path, std::string& source, std::vector<std::string>& files )
+{
+	std::ifstream srcFile( path );
+	std::string line, name;
+
+	if( srcFile.is_open() == false )
+		return false;
+
+	int number = (int)files.size();
+	files.push_back( path );
+
+	size_t slash = path.find_last_of( "/\\" );
+	std::string directory = slash == std::string::npos ? "" : path.substr( 0, slash + 1 );
+
+	for( int lineNumber = 1; std::getline( srcFile, line ); ++lineNumber )
+	{
+		if( ParseInclude( line, name ) == false )
+		{
+			source += line;
+			source += '\n';
+			continue;
+		}
+
+		std::string includePath = directory + name;
+
+		// included before, an empty line keeps the numbering
+		if( std::find( files.begin(), files.end(), includePath ) != files.end() )
+		{
+			source += '\n';
+			continue;
+		}
+
+		source += "#line 1 " + std::to_string( files.size() ) + "\n";
+		if( AppendFile( includePath, source, files ) == false )
+		{
+			std::cerr << "Unable to open shader include: " << includePath << " (" << path << ":" << lineNumber << ")" << std::endl;
+			return false;
+		}
+		source += "#line " + std::to_string( lineNumber + 1 ) + " " + std::to_string( number ) + "\n";
+	}
+	srcFile.close();
+
+	return true;
+}
+
+bool Shader::ReadSource( const std::string& path, std::string& source, std::vector<std::string>* files )
+{
+	std::vector<std::string> included;
+
+	source = "";
+
+	bool read = AppendFile( path, source, included );
+
+	if( files != NULL )
+		*files = included;
+
+	return read;
+}
+
+// Right after the #version line, which must stay first; the #line after them keeps the
+// line numbers of the file
+void Shader::InsertDefines( std::string& source, const std::string& defines )
+{
+	if( defines.empty() == true )
+		return;
+
+	size_t version = source.find( "#version" );
+	if( version == std::string::npos )
+	{
+		source = defines + "#line 1 0\n" + source;
+		return;
+	}
+
+	size_t end = source.find( '\n', version );
+	end = end == std::string::npos ? source.size() : end + 1;
+
+	int nextLine = 1 + (int)std::count( source.begin(), source.begin() + end, '\n' );
+	source.insert( end, defines + "#line " + std::to_string( nextLine ) + " 0\n" );
+}
+
 /*=================================================================================================
   GET STATUS
 =================================================================================================*/
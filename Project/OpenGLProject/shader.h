@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <string>
+#include <vector>
 
 class Shader
 {
@@ -12,9 +13,12 @@ public:
 	~Shader();
 
 public:
-	void Create( std::string shaderPath, GLenum shaderType );
+	// defines are #define lines, inserted after #version; see ShaderProgram::GetVariant().
+	// checkStatus false leaves the compile running, for CheckCompileStatus() later.
+	void Create( std::string shaderPath, GLenum shaderType, std::string defines = "", bool checkStatus = true );
 	void Delete();
-	void Load();
+	void Load( bool checkStatus = true );
+	void CheckCompileStatus() const;
 
 public:
 	int GetStatus( GLenum ) const;
@@ -24,12 +28,24 @@ public:
 	std::string GetInfoLog() const;
 	std::string GetSource() const;
 
+	// The text of a shader file with every #include "file" replaced by that file, named
+	// relative to the file that includes it. A file is included once per shader, later
+	// includes of it are dropped. #line directives keep compiler logs pointing at the
+	// right lines: source string 0 is the shader file, n the n-th included file (files[n]).
+	// False if the shader or one of its includes cannot be opened.
+	static bool ReadSource( const std::string& path, std::string& source, std::vector<std::string>* files = NULL );
+
 	GLuint      GetID()   const { return ID;   }
 	GLenum      GetType() const { return Type; }
 	std::string GetPath() const { return Path; }
+	std::string GetDefines() const { return Defines; }
 
 private:
+	static void InsertDefines( std::string& source, const std::string& defines );
+
 	GLuint ID;
 	GLenum Type;
 	std::string Path;
+	std::string Defines;
+	std::vector<std::string> Files; // Path and its includes, by source string number
 };
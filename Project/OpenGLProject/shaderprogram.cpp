@@ -1,5 +1,18 @@
 #include "shaderprogram.h"
+#include "glstate.h"
+#include "programcache.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ProgramBinaryCache* ShaderProgram::BinaryCache = NULL;
+
+static const GLenum StageTypes[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER };
 
 /*=================================================================================================
   CONSTRUCTORS
@@ -8,20 +21,32 @@
 ShaderProgram::ShaderProgram()
 {
 	ID = 0;
+	Key = 0;
+	Pending = false;
+	Fallback = NULL;
 }
 
 ShaderProgram::ShaderProgram( std::string cspath )
 {
+	Key = 0;
+	Pending = false;
+	Fallback = NULL;
 	Create( cspath );
 }
 
 ShaderProgram::ShaderProgram( std::string vspath, std::string fspath )
 {
+	Key = 0;
+	Pending = false;
+	Fallback = NULL;
 	Create( vspath, fspath );
 }
 
 ShaderProgram::ShaderProgram( std::string vspath, std::string gspath, std::string fspath )
 {
+	Key = 0;
+	Pending = false;
+	Fallback = NULL;
 	Create( vspath, gspath, fspath );
 }
 
@@ -40,50 +65,110 @@ ShaderProgram::~ShaderProgram()
 
 void ShaderProgram::Create( std::string cspath )
 {
-	ID = glCreateProgram();
-
-	if( ID != 0 )
-	{
-		computeShader.Create( cspath, GL_COMPUTE_SHADER );
-		glAttachShader( ID, computeShader.GetID() );
-
-		Link();
-	}
+	Build( "", "", "", cspath, false );
 }
 
 void ShaderProgram::Create( std::string vspath, std::string fspath )
 {
-	ID = glCreateProgram();
+	Build( vspath, "", fspath, "", false );
+}
 
-	if( ID != 0 )
-	{
-		vertexShader.Create( vspath, GL_VERTEX_SHADER );
-		glAttachShader( ID, vertexShader.GetID() );
+void ShaderProgram::Create( std::string vspath, std::string gspath, std::string fspath )
+{
+	Build( vspath, gspath, fspath, "", false );
+}
 
-		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER );
-		glAttachShader( ID, fragmentShader.GetID() );
+void ShaderProgram::CreateAsync( std::string cspath )
+{
+	Build( "", "", "", cspath, true );
+}
 
-		Link();
-	}
+void ShaderProgram::CreateAsync( std::string vspath, std::string fspath )
+{
+	Build( vspath, "", fspath, "", true );
 }
 
-void ShaderProgram::Create( std::string vspath, std::string gspath, std::string fspath )
+void ShaderProgram::CreateAsync( std::string vspath, std::string gspath, std::string fspath )
+{
+	Build( vspath, gspath, fspath, "", true );
+}
+
+// Links from the binary cache when it has this program, otherwise compiles the stages
+// that have a path and saves the result for the next launch. Asynchronous builds query
+// nothing after submitting, since any status query waits for the compiler.
+void ShaderProgram::Build( std::string vspath, std::string gspath, std::string fspath, std::string cspath, bool async )
 {
 	ID = glCreateProgram();
 
 	if( ID != 0 )
 	{
-		vertexShader.Create( vspath, GL_VERTEX_SHADER );
-		glAttachShader( ID, vertexShader.GetID() );
+		StagePaths[0] = vspath;
+		StagePaths[1] = gspath;
+		StagePaths[2] = fspath;
+		StagePaths[3] = cspath;
+
+		bool cached = BinaryCache != NULL && BinaryCache->IsEnabled();
+		if( cached )
+		{
+			Key = BinaryCache->MakeKey( ReadSources(), Defines );
+
+			if( BinaryCache->Load( ID, Key ) == true )
+			{
+				Reflect();
+				return;
+			}
+
+			glProgramParameteri( ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+		}
+
+		for( int stage = 0; stage < NumStages; ++stage )
+		{
+			if( StagePaths[stage].empty() == false )
+			{
+				GetStage( stage ).Create( StagePaths[stage], StageTypes[stage], Defines, async == false );
+				glAttachShader( ID, GetStage( stage ).GetID() );
+			}
+		}
+
+		if( async == false )
+		{
+			Link();
+			return;
+		}
+
+		// let the driver use as many compiler threads as it likes
+		static bool threadsSet = false;
+		if( threadsSet == false && GLEW_KHR_parallel_shader_compile )
+			glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+		threadsSet = true;
+
+		glLinkProgram( ID );
+		Pending = true;
+	}
+}
 
-		geometryShader.Create( gspath, GL_GEOMETRY_SHADER );
-		glAttachShader( ID, geometryShader.GetID() );
+Shader& ShaderProgram::GetStage( int stage )
+{
+	switch( stage ) {
+		case 0: return vertexShader;
+		case 1: return geometryShader;
+		case 2: return fragmentShader;
+		default: return computeShader;
+	}
+}
 
-		fragmentShader.Create( fspath, GL_FRAGMENT_SHADER );
-		glAttachShader( ID, fragmentShader.GetID() );
+// Every stage's source text, empty for unused stages so that a stage cannot pass for another
+std::vector<std::string> ShaderProgram::ReadSources( void ) const
+{
+	std::vector<std::string> sources( NumStages );
 
-		Link();
+	for( int stage = 0; stage < NumStages; ++stage )
+	{
+		if( StagePaths[stage].empty() == false )
+			Shader::ReadSource( StagePaths[stage], sources[stage] );
 	}
+
+	return sources;
 }
 
 /*=================================================================================================
@@ -94,15 +179,24 @@ void ShaderProgram::Delete( void )
 {
 	if( ID != 0 )
 	{
-		glDetachShader( ID, vertexShader.GetID() );
-		glDetachShader( ID, geometryShader.GetID() );
-		glDetachShader( ID, fragmentShader.GetID() );
-		glDetachShader( ID, computeShader.GetID() );
+		// unused stages, and every stage of a program from the binary cache, were never attached
+		for( int stage = 0; stage < NumStages; ++stage )
+		{
+			if( GetStage( stage ).GetID() != 0 )
+				glDetachShader( ID, GetStage( stage ).GetID() );
+		}
 
 		glDeleteProgram( ID );
 
 		ID = 0;
 	}
+
+	Pending = false;
+
+	Variants.clear();
+	Defines = "";
+	Uniforms.clear();
+	BlockBindings.clear();
 }
 
 /*=================================================================================================
@@ -112,10 +206,43 @@ void ShaderProgram::Delete( void )
 void ShaderProgram::Link( void )
 {
 	glLinkProgram( ID );
+	FinishLink();
+}
+
+// Everything after glLinkProgram() that needs its result
+void ShaderProgram::FinishLink( void )
+{
+	// compile errors of an asynchronous build have not been printed yet
+	if( Pending == true )
+	{
+		for( int stage = 0; stage < NumStages; ++stage )
+		{
+			if( GetStage( stage ).GetID() != 0 )
+				GetStage( stage ).CheckCompileStatus();
+		}
+	}
+
+	Pending = false;
 
 	// If the program didn't link successfully, print log
 	if( GetLinkStatus() == 0 )
 		std::cerr << "shader program " << ID << " link log" << std::endl << GetInfoLog() << std::endl;
+
+	Reflect();
+
+	if( BinaryCache != NULL && BinaryCache->IsEnabled() )
+		BinaryCache->Store( ID, Key );
+}
+
+// After every link, from source or from a binary
+void ShaderProgram::Reflect( void )
+{
+	// locations can change with every link, so Reload() gets a new table too
+	BuildUniformTable();
+
+	// and linking resets every block to binding 0
+	for( size_t i = 0; i < BlockBindings.size(); ++i )
+		ApplyBlockBinding( BlockBindings[i].first, BlockBindings[i].second );
 }
 
 /*=================================================================================================
@@ -135,22 +262,168 @@ void ShaderProgram::Validate( void )
   RELOAD
 =================================================================================================*/
 
+// Always compiles: stages of a program that came from the binary cache are created here
+// the first time. The new binary replaces the old one in the cache.
 void ShaderProgram::Reload( void )
 {
-	vertexShader.Load();
-	geometryShader.Load();
-	fragmentShader.Load();
-	computeShader.Load();
+	if( ID == 0 )
+		return;
+
+	Pending = false; // rebuilt from scratch, and synchronously
+
+	for( int stage = 0; stage < NumStages; ++stage )
+	{
+		if( StagePaths[stage].empty() == true )
+			continue;
+
+		Shader& shader = GetStage( stage );
+		if( shader.GetID() == 0 )
+		{
+			shader.Create( StagePaths[stage], StageTypes[stage], Defines );
+			glAttachShader( ID, shader.GetID() );
+		}
+		else
+			shader.Load();
+	}
+
+	bool cached = BinaryCache != NULL && BinaryCache->IsEnabled();
+	if( cached )
+	{
+		Key = BinaryCache->MakeKey( ReadSources(), Defines );
+		glProgramParameteri( ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+	}
+
 	Link();
+
+	for( auto variant = Variants.begin(); variant != Variants.end(); ++variant )
+		variant->second->Reload();
+}
+
+/*=================================================================================================
+  VARIANTS
+=================================================================================================*/
+
+ShaderProgram* ShaderProgram::GetVariant( const std::vector<std::string>& defines, bool async )
+{
+	std::string text = MakeDefines( defines );
+	if( text == Defines )
+		return this;
+
+	std::unique_ptr<ShaderProgram>& variant = Variants[text];
+	if( variant != NULL )
+		return variant.get();
+
+	variant.reset( new ShaderProgram() );
+	variant->Defines = text;
+	variant->Build( StagePaths[0], StagePaths[1], StagePaths[2], StagePaths[3], async );
+
+	for( size_t i = 0; i < BlockBindings.size(); ++i )
+		variant->BindUniformBlock( BlockBindings[i].first.c_str(), BlockBindings[i].second );
+
+	return variant.get();
+}
+
+// One #define line per define, sorted, so that a define set has one text whatever its order
+std::string ShaderProgram::MakeDefines( std::vector<std::string> defines )
+{
+	std::sort( defines.begin(), defines.end() );
+	defines.erase( std::unique( defines.begin(), defines.end() ), defines.end() );
+
+	std::string text;
+	for( size_t i = 0; i < defines.size(); ++i )
+	{
+		if( defines[i].empty() == false )
+			text += "#define " + defines[i] + "\n";
+	}
+
+	return text;
 }
 
 /*=================================================================================================
   USE
 =================================================================================================*/
 
-void ShaderProgram::Use( void )
+bool ShaderProgram::Use( void )
+{
+	if( IsReady() == true )
+	{
+		GLState.UseProgram( ID );
+		return ID != 0;
+	}
+
+	if( Fallback != NULL )
+		return Fallback->Use();
+
+	return false;
+}
+
+/*=================================================================================================
+  ASYNCHRONOUS BUILDS
+=================================================================================================*/
+
+bool ShaderProgram::IsReady( void )
+{
+	if( Pending == false )
+		return true;
+
+	if( GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile )
+	{
+		GLint done = GL_FALSE;
+		glGetProgramiv( ID, GL_COMPLETION_STATUS_KHR, &done );
+		if( done == GL_FALSE )
+			return false;
+	}
+
+	FinishLink();
+	return true;
+}
+
+void ShaderProgram::Finish( void )
+{
+	if( Pending == true )
+		FinishLink();
+}
+
+/*=================================================================================================
+  UNIFORM BLOCKS
+=================================================================================================*/
+
+bool ShaderProgram::BindUniformBlock( const GLchar* blockName, GLuint binding )
+{
+	bool found = false;
+	for( size_t i = 0; i < BlockBindings.size(); ++i )
+	{
+		if( BlockBindings[i].first == blockName )
+		{
+			BlockBindings[i].second = binding;
+			found = true;
+		}
+	}
+
+	if( found == false )
+		BlockBindings.push_back( std::make_pair( std::string( blockName ), binding ) );
+
+	for( auto variant = Variants.begin(); variant != Variants.end(); ++variant )
+		variant->second->BindUniformBlock( blockName, binding );
+
+	// a pending program gets its blocks bound once it has linked
+	if( Pending == true )
+		return true;
+
+	return ApplyBlockBinding( blockName, binding );
+}
+
+bool ShaderProgram::ApplyBlockBinding( const std::string& blockName, GLuint binding )
 {
-	glUseProgram( ID );
+	if( GetLinkStatus() != 1 )
+		return false;
+
+	GLuint index = glGetUniformBlockIndex( ID, blockName.c_str() );
+	if( index == GL_INVALID_INDEX )
+		return false;
+
+	glUniformBlockBinding( ID, index, binding );
+	return true;
 }
 
 /*=================================================================================================
@@ -250,6 +523,74 @@ std::string ShaderProgram::GetInfoLog( void ) const
 	return stringLog;
 }
 
+/*=================================================================================================
+  UNIFORM LOCATIONS
+=================================================================================================*/
+
+// Every active uniform under each name it can be set by: arrays as "name", "name[0]" and
+// "name[i]" for each element. Members of uniform blocks have no location and are left out.
+void ShaderProgram::BuildUniformTable( void )
+{
+	Uniforms.clear();
+
+	if( GetLinkStatus() != 1 )
+		return;
+
+	int count = GetNumActiveUniforms();
+	std::vector<GLchar> buffer( std::max( GetActiveUniformMaxLength(), 1 ) );
+
+	for( int i = 0; i < count; ++i )
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveUniform( ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data() );
+
+		std::string name( buffer.data(), length );
+		GLint location = glGetUniformLocation( ID, name.c_str() );
+		if( location < 0 )
+			continue;
+
+		std::vector<std::string> names( 1, name );
+
+		// arrays are reported as "name[0]"
+		size_t bracket = name.rfind( "[0]" );
+		if( bracket != std::string::npos && bracket + 3 == name.size() )
+		{
+			std::string base = name.substr( 0, bracket );
+			names.push_back( base );
+			for( GLint element = 1; element < size; ++element )
+				names.push_back( base + "[" + std::to_string( element ) + "]" );
+		}
+
+		for( size_t n = 0; n < names.size(); ++n )
+		{
+			UniformEntry entry;
+			entry.Name = names[n];
+			entry.Location = n < 2 ? location : glGetUniformLocation( ID, names[n].c_str() );
+
+			// on a hash collision the first name keeps the slot, the other goes to the driver
+			Uniforms.insert( std::make_pair( HashName( entry.Name.c_str() ), entry ) );
+		}
+	}
+}
+
+GLint ShaderProgram::getUniformLocation( const GLchar* name ) const
+{
+	// Use() bound the fallback, so set its uniforms instead
+	if( Pending == true )
+		return Fallback != NULL ? Fallback->getUniformLocation( name ) : -1;
+
+	auto found = Uniforms.find( HashName( name ) );
+	if( found == Uniforms.end() )
+		return -1;
+
+	if( strcmp( found->second.Name.c_str(), name ) != 0 )
+		return glGetUniformLocation( ID, name );
+
+	return found->second.Location;
+}
+
 /*=================================================================================================
   UNIFORM SETTERS
 =================================================================================================*/
@@ -2,9 +2,17 @@
 
 #include <GL/glew.h>
 #include <GL/freeglut.h>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "shader.h"
 
+class ProgramBinaryCache;
+
 class ShaderProgram
 {
 public:
@@ -22,7 +30,35 @@ public:
 	void Link();
 	void Validate();
 	void Reload();
-	void Use();
+
+	// Binds the program, or the fallback while it is still being built; false when
+	// neither can be used, in which case nothing should be drawn with it
+	bool Use();
+
+	// Like Create(), but returns once compiling and linking have been submitted. Submit
+	// every program first, so the driver can build them side by side where it supports
+	// GL_KHR_parallel_shader_compile, then poll IsReady() across frames.
+	void CreateAsync( std::string cspath );
+	void CreateAsync( std::string vspath, std::string fspath );
+	void CreateAsync( std::string vspath, std::string gspath, std::string fspath );
+
+	// Never waits where the driver can report completion, otherwise finishes the build
+	bool IsReady();
+	// Waits for the build
+	void Finish();
+	// Drawn with instead, and asked for uniform locations, until this program is ready
+	void SetFallback( ShaderProgram* fallback ) { Fallback = fallback; }
+
+	// These stages compiled with defines, e.g. { "UNLIT", "MAX_LIGHTS 4" }, each one put
+	// after #version as a #define line. Built the first time a define set is asked for and
+	// kept until Delete(), so every permutation compiles once; the order of the defines
+	// does not matter, and none gives this program. Variants have the uniform blocks bound
+	// on this program, now and later, and Reload() reloads them too.
+	ShaderProgram* GetVariant( const std::vector<std::string>& defines, bool async = false );
+
+	// Reads the named uniform block from the buffer bound to binding (glBindBufferRange).
+	// Kept across Reload(); false while the program has no such active block.
+	bool BindUniformBlock( const GLchar* blockName, GLuint binding );
 
 public:
 	int GetStatus( GLenum ) const;
@@ -40,11 +76,24 @@ public:
 	std::string GetInfoLog( void ) const;
 
 	GLuint GetID() { return ID; }
+	std::string GetDefines() const { return Defines; }
+
+	// Programs created from then on are linked from this cache when it has them, and saved
+	// to it when it does not; NULL, the default, always compiles
+	static void SetBinaryCache( ProgramBinaryCache* cache ) { BinaryCache = cache; }
 
 public:
-	GLint getUniformLocation( const GLchar* name ) const
+	// Looked up in a table of the active uniforms, made when the program links, instead of
+	// asking the driver. Unknown names give -1, like glGetUniformLocation() does.
+	GLint getUniformLocation( const GLchar* name ) const;
+
+	// 32-bit FNV-1a, the key of the uniform table; constexpr, so it can hash literals at compile time
+	static constexpr uint32_t HashName( const GLchar* name )
 	{
-		return glGetUniformLocation( ID, name );
+		uint32_t hash = 2166136261u;
+		while( *name != 0 )
+			hash = ( hash ^ (unsigned char)*name++ ) * 16777619u;
+		return hash;
 	}
 
 	//@{
@@ -124,6 +173,33 @@ public:
 	//@}
 
 private:
+	struct UniformEntry
+	{
+		std::string Name; // checked on lookup, in case two names share a hash
+		GLint Location;
+	};
+
+	static const int NumStages = 4; // vertex, geometry, fragment, compute
+
+	void Build( std::string vspath, std::string gspath, std::string fspath, std::string cspath, bool async );
+	void FinishLink();
+	static std::string MakeDefines( std::vector<std::string> defines );
+	Shader& GetStage( int stage );
+	std::vector<std::string> ReadSources() const;
+	void Reflect();
+	void BuildUniformTable();
+	bool ApplyBlockBinding( const std::string& blockName, GLuint binding );
+
 	GLuint ID;
 	Shader vertexShader, geometryShader, fragmentShader, computeShader;
+	std::string StagePaths[NumStages]; // empty for unused stages
+	std::string Defines; // #define lines of a variant, sorted; empty otherwise
+	std::map<std::string, std::unique_ptr<ShaderProgram>> Variants; // by their Defines
+	uint64_t Key; // in the binary cache
+	bool Pending; // linked asynchronously, FinishLink() not done yet
+	ShaderProgram* Fallback;
+	std::unordered_map<uint32_t, UniformEntry> Uniforms;
+	std::vector<std::pair<std::string, GLuint>> BlockBindings;
+
+	static ProgramBinaryCache* BinaryCache;
 };
@@ -0,0 +1,9 @@
+// Shared by every program, written once per frame; see FrameConstants in uniformbuffer.h
+layout(std140) uniform FrameConstants
+{
+	mat4 projectionMatrix;     // scene camera
+	mat4 viewMatrix;
+	mat4 axisProjectionMatrix; // axis gizmo
+	mat4 axisViewMatrix;
+	mat4 axisModelMatrix;
+};
@@ -0,0 +1,36 @@
+#version 400
+
+// Variants: UNLIT skips the lighting, UNTEXTURED draws flat gray instead of the texture
+
+#ifndef UNLIT
+in  vec3 vert_Normal;
+#endif
+#ifndef UNTEXTURED
+in  vec2 vert_TexCoord;
+flat in float vert_Layer;
+#endif
+out vec4 frag_Color;
+
+#ifndef UNTEXTURED
+uniform sampler2DArray planetTextures;
+#endif
+
+// matches the fixed-function setup(): 0.5 global ambient plus a white
+// directional light along the eye-space +Z axis (the GL_LIGHT0 default)
+const float ambient = 0.5;
+const vec3  lightDirection = vec3( 0.0, 0.0, 1.0 );
+
+void main(void)
+{
+#ifdef UNTEXTURED
+	vec4  texel   = vec4( 0.5, 0.5, 0.5, 1.0 );
+#else
+	vec4  texel   = texture( planetTextures, vec3( vert_TexCoord, vert_Layer ) );
+#endif
+#ifdef UNLIT
+	frag_Color = texel;
+#else
+	float diffuse = max( dot( normalize( vert_Normal ), lightDirection ), 0.0 );
+	frag_Color = vec4( texel.rgb * min( ambient + diffuse, 1.0 ), texel.a );
+#endif
+}
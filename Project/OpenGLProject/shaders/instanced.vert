@@ -0,0 +1,43 @@
+#version 400
+
+// Variants: UNLIT drops the normal, UNTEXTURED the texture coordinates and layer
+
+layout(location=0) in vec3  in_Position;
+layout(location=3) in vec4  in_Orbit; // orbit angle, orbit distance, radius, spin angle
+#ifndef UNLIT
+layout(location=1) in vec3  in_Normal;
+out vec3 vert_Normal;
+#endif
+#ifndef UNTEXTURED
+layout(location=2) in vec2  in_TexCoord;
+layout(location=4) in float in_Layer;
+out vec2 vert_TexCoord;
+flat out float vert_Layer;
+#endif
+
+#include "frameconstants.glsl"
+
+// same rotation as glm::rotate( m, a, vec3( 0, 1, 0 ) )
+vec3 rotateY( vec3 v, float degrees )
+{
+	float a = radians( degrees );
+	float c = cos( a ), s = sin( a );
+	return vec3( c * v.x + s * v.z, v.y, -s * v.x + c * v.z );
+}
+
+void main(void)
+{
+	// spin around its own axis, move out to the orbit distance, then along the orbit
+	vec3 position = rotateY( in_Position * in_Orbit.z, in_Orbit.w );
+	position = rotateY( position + vec3( in_Orbit.y, 0.0, 0.0 ), in_Orbit.x );
+
+	gl_Position   = projectionMatrix * viewMatrix * vec4( position, 1.0 );
+#ifndef UNLIT
+	vec3 normal   = rotateY( rotateY( in_Normal, in_Orbit.w ), in_Orbit.x );
+	vert_Normal   = mat3( viewMatrix ) * normal;
+#endif
+#ifndef UNTEXTURED
+	vert_TexCoord = in_TexCoord;
+	vert_Layer    = in_Layer;
+#endif
+}
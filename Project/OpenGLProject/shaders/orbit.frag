@@ -0,0 +1,10 @@
+#version 400
+
+out vec4 frag_Color;
+
+uniform vec4 orbitColor;
+
+void main(void)
+{
+	frag_Color = orbitColor;
+}
@@ -0,0 +1,11 @@
+#version 400
+
+layout(location=0) in vec2  in_Circle; // point on the unit circle, (x, z)
+layout(location=1) in float in_Radius; // per-instance orbit distance
+
+#include "frameconstants.glsl"
+
+void main(void)
+{
+	gl_Position = projectionMatrix * viewMatrix * vec4( in_Circle.x * in_Radius, 0.0, in_Circle.y * in_Radius, 1.0 );
+}
@@ -0,0 +1,11 @@
+#version 400
+
+in  vec3 vert_Direction;
+out vec4 frag_Color;
+
+uniform samplerCube skyboxTexture;
+
+void main(void)
+{
+	frag_Color = texture( skyboxTexture, vert_Direction );
+}
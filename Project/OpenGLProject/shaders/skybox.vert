@@ -0,0 +1,14 @@
+#version 400
+
+layout(location=0) in vec3 in_Position;
+out vec3 vert_Direction;
+
+#include "frameconstants.glsl"
+
+void main(void)
+{
+	// rotation only, the sky never gets closer; z = w puts the vertex on the far plane
+	vec4 position  = projectionMatrix * mat4( mat3( viewMatrix ) ) * vec4( in_Position, 1.0 );
+	gl_Position    = position.xyww;
+	vert_Direction = in_Position;
+}
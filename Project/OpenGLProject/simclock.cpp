@@ -0,0 +1,111 @@
+#include "simclock.h"
+
+/*=================================================================================================
+  SIMULATION CLOCK
+=================================================================================================*/
+
+SimulationClock::SimulationClock()
+{
+	Create( 1.0 / 60.0, 8 );
+}
+
+SimulationClock::SimulationClock( double stepSeconds, int maxStepsPerFrame )
+{
+	Create( stepSeconds, maxStepsPerFrame );
+}
+
+void SimulationClock::Create( double stepSeconds, int maxStepsPerFrame )
+{
+	StepSeconds = stepSeconds;
+	MaxStepsPerFrame = maxStepsPerFrame;
+	Paused = false;
+
+	Reset();
+}
+
+void SimulationClock::Reset( void )
+{
+	LastTime = Clock::now();
+	Accumulator = 0.0;
+	StepCount = 0;
+}
+
+// Time spent paused is skipped, the simulation picks up exactly where it stopped
+void SimulationClock::Pause( void )
+{
+	Paused = true;
+}
+
+void SimulationClock::Resume( void )
+{
+	if( Paused )
+		LastTime = Clock::now();
+
+	Paused = false;
+}
+
+// Returns how many fixed steps the simulation has to take this frame. Long stalls
+// (a dragged window, a breakpoint) are clamped to MaxStepsPerFrame so the simulation
+// cannot fall into a spiral of ever longer catch-up frames.
+int SimulationClock::Advance( void )
+{
+	Clock::time_point now = Clock::now();
+	double elapsed = std::chrono::duration<double>( now - LastTime ).count();
+	LastTime = now;
+
+	if( Paused )
+		return 0;
+
+	if( elapsed > MaxStepsPerFrame * StepSeconds )
+		elapsed = MaxStepsPerFrame * StepSeconds;
+
+	return AdvanceBy( elapsed );
+}
+
+// Advances by a given amount of simulated time instead of the real time that passed, e.g.
+// a fixed 1/60 s per frame when rendering offline. There is no per-frame step limit here.
+int SimulationClock::AdvanceBy( double seconds )
+{
+	if( Paused )
+		return 0;
+
+	Accumulator += seconds;
+
+	int steps = (int)( Accumulator / StepSeconds );
+	Accumulator -= steps * StepSeconds;
+	StepCount += steps;
+
+	return steps;
+}
+
+/*=================================================================================================
+  FRAME LIMITER
+=================================================================================================*/
+
+FrameLimiter::FrameLimiter()
+{
+	LastFrame = Clock::now();
+	MinFrameSeconds = 1.0 / 60.0;
+}
+
+// 0 or less removes the cap
+void FrameLimiter::SetMaxFramesPerSecond( double fps )
+{
+	MinFrameSeconds = fps > 0.0 ? 1.0 / fps : 0.0;
+}
+
+// True once per frame interval; the frame is counted as started when this returns true
+bool FrameLimiter::IsFrameDue( void )
+{
+	if( GetSecondsUntilNextFrame() > 0.0 )
+		return false;
+
+	LastFrame = Clock::now();
+	return true;
+}
+
+double FrameLimiter::GetSecondsUntilNextFrame( void ) const
+{
+	double elapsed = std::chrono::duration<double>( Clock::now() - LastFrame ).count();
+	return MinFrameSeconds - elapsed;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+
+// Fixed-timestep simulation clock. Real time is accumulated every frame and handed out
+// in whole steps of StepSeconds, so the simulation advances the same way no matter how
+// often or how regularly frames are drawn. The remainder is exposed as an interpolation
+// factor between the previous and the current simulation state.
+class SimulationClock
+{
+public:
+	SimulationClock();
+	SimulationClock( double stepSeconds, int maxStepsPerFrame );
+
+public:
+	void Create( double stepSeconds, int maxStepsPerFrame );
+	void Reset();
+	void Pause();
+	void Resume();
+	int  Advance();
+	int  AdvanceBy( double seconds );
+
+public:
+	bool      IsPaused()       const { return Paused;       }
+	double    GetStepSeconds() const { return StepSeconds;  }
+	long long GetStepCount()   const { return StepCount;    }
+	float     GetAlpha()       const { return (float)( Accumulator / StepSeconds ); }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point LastTime;
+	double Accumulator;
+	double StepSeconds;
+	int MaxStepsPerFrame;
+	long long StepCount;
+	bool Paused;
+};
+
+// Caps how often a new frame is requested, so an idle callback does not redraw (and
+// burn a whole core) faster than the display can show
+class FrameLimiter
+{
+public:
+	FrameLimiter();
+
+public:
+	void   SetMaxFramesPerSecond( double fps );
+	bool   IsFrameDue();
+	double GetSecondsUntilNextFrame() const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point LastFrame;
+	double MinFrameSeconds;
+};
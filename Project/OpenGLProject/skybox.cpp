@@ -0,0 +1,174 @@
+#include "skybox.h"
+#include "glstate.h"
+#include <iostream>
+#include <vector>
+#include "../CImg-3.3.6/CImg.h"
+using namespace cimg_library;
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+Skybox::Skybox()
+{
+	VAO = 0;
+	VBO = 0;
+	Texture = 0;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+Skybox::~Skybox()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void Skybox::Create( const std::string& imagePath, int faceSize, TextureStreamer* streamer )
+{
+	Delete();
+
+	std::vector<TextureStreamer::Image> faces;
+	if( streamer == NULL )
+		BuildFaces( imagePath, faceSize, faces );
+
+	glGenTextures( 1, &Texture );
+	GLState.BindTexture( 0, GL_TEXTURE_CUBE_MAP, Texture );
+
+	if( streamer == NULL )
+	{
+		for( size_t face = 0; face < faces.size(); ++face )
+			glTexImage2D( faces[face].Target, 0, GL_RGB, faceSize, faceSize, 0, GL_RGB, GL_UNSIGNED_BYTE, faces[face].Pixels.data() );
+	}
+	else
+	{
+		// an empty sky is a better stand-in for stars than a checkerboard
+		std::vector<unsigned char> black( 3 * faceSize * faceSize, 0 );
+		for( int face = 0; face < 6; ++face )
+			glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, faceSize, faceSize, 0, GL_RGB, GL_UNSIGNED_BYTE, black.data() );
+
+		streamer->Request( Texture, GL_TEXTURE_CUBE_MAP, imagePath, [faceSize]( const std::string& path, std::vector<TextureStreamer::Image>& images ) {
+			return BuildFaces( path, faceSize, images );
+		} );
+	}
+
+	glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE );
+
+	// unit cube, two triangles per face
+	static const GLfloat cube[] = {
+		-1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,  -1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+		 1.0f, -1.0f, -1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,   1.0f,  1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,   1.0f, -1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+		-1.0f,  1.0f, -1.0f,   1.0f,  1.0f, -1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f
+	};
+
+	glGenVertexArrays( 1, &VAO );
+	GLState.BindVertexArray( VAO );
+
+	glGenBuffers( 1, &VBO );
+	glBindBuffer( GL_ARRAY_BUFFER, VBO );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( cube ), cube, GL_STATIC_DRAW );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), (void*)0 );
+	glEnableVertexAttribArray( 0 );
+
+	GLState.BindVertexArray( 0 );
+}
+
+/*=================================================================================================
+  FACES
+=================================================================================================*/
+
+// Builds all six cube faces from one image. Each face is a rotated and/or mirrored copy,
+// which keeps a single tiled star field from repeating visibly across the seams. Touches
+// no GL state, so it can run on a loader thread.
+bool Skybox::BuildFaces( const std::string& imagePath, int faceSize, std::vector<TextureStreamer::Image>& faces )
+{
+	CImg<unsigned char> image;
+	image.load( imagePath.c_str() );
+	image.resize( faceSize, faceSize, 1, 3 );
+
+	int size = faceSize * faceSize;
+
+	for( int face = 0; face < 6; ++face )
+	{
+		CImg<unsigned char> faceImage = image.get_rotate( 90.0f * ( face / 2 ) );
+		if( face % 2 == 1 )
+			faceImage.mirror( 'x' );
+
+		TextureStreamer::Image out;
+		out.Target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+		out.Layer = 0;
+		out.Width = faceSize;
+		out.Height = faceSize;
+		out.Pixels.resize( 3 * size );
+		faceImage.interleave_rgb( out.Pixels.data() );
+
+		faces.push_back( std::move( out ) );
+	}
+
+	return true;
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+void Skybox::Delete( void )
+{
+	if( VAO != 0 )
+	{
+		glDeleteBuffers( 1, &VBO );
+		glDeleteVertexArrays( 1, &VAO );
+	}
+
+	if( Texture != 0 )
+		glDeleteTextures( 1, &Texture );
+
+	VAO = 0;
+	VBO = 0;
+	Texture = 0;
+}
+
+/*=================================================================================================
+  DRAW
+=================================================================================================*/
+
+// Expects the skybox shader in use with its matrices set. Depth writes are off and the
+// test is GL_LEQUAL, since every sky fragment lies exactly on the cleared far plane.
+void Skybox::Draw( void ) const
+{
+	if( VAO == 0 )
+		return;
+
+	GLState.BindTexture( 0, GL_TEXTURE_CUBE_MAP, Texture );
+	GLState.BindSampler( 0, 0 ); // the cubemap's own linear/clamp parameters
+	GLState.Disable( GL_CULL_FACE ); // the camera sits inside the cube
+
+	glDepthFunc( GL_LEQUAL );
+	glDepthMask( GL_FALSE );
+
+	GLState.BindVertexArray( VAO );
+	glDrawArrays( GL_TRIANGLES, 0, 36 );
+	GLState.CountDraw();
+
+	glDepthMask( GL_TRUE );
+	glDepthFunc( GL_LESS );
+	GLState.Enable( GL_CULL_FACE );
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <string>
+#include <vector>
+#include "texturestreamer.h"
+
+// Star background as a cubemap on a unit cube around the camera. shaders/skybox.vert
+// pins every vertex to the far plane, so drawing it after the opaque geometry with a
+// GL_LEQUAL depth test lets early depth rejection skip every pixel already covered.
+class Skybox
+{
+public:
+	Skybox();
+	~Skybox();
+
+public:
+	// With a streamer the faces are loaded in the background, black until they arrive
+	void Create( const std::string& imagePath, int faceSize, TextureStreamer* streamer = NULL );
+	void Delete();
+	void Draw() const;
+
+public:
+	GLuint GetTexture() const { return Texture; }
+
+	static bool BuildFaces( const std::string& imagePath, int faceSize, std::vector<TextureStreamer::Image>& faces );
+
+private:
+	GLuint VAO;
+	GLuint VBO;
+	GLuint Texture;
+};
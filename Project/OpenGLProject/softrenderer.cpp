@@ -0,0 +1,356 @@
+#include "softrenderer.h"
+#include "culling.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+using namespace cimg_library;
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+SoftwareRenderer::SoftwareRenderer()
+{
+	CachedView = glm::mat4( 0.0f );
+	CachedScaleX = 0.0f;
+	CachedFocale = 0.0f;
+	CachedWidth = 0;
+	CachedHeight = 0;
+	Pool = NULL;
+	TileHeight = 32;
+	NumTransformed = 0;
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+// Same unit sphere as Mesh::CreateSphere, with the same texture coordinates, and one copy
+// of its primitives per texture layer since texturize_object3d() rewrites them in place.
+// A texture that cannot be loaded is replaced by flat gray.
+void SoftwareRenderer::Create( const std::string* textureFiles, int numTextures, int textureSize, int sphereSegments )
+{
+	int slices = sphereSegments;
+	int stacks = sphereSegments;
+	int numVertices = ( slices + 1 ) * ( stacks + 1 );
+
+	SphereVertices.assign( numVertices, 3 );
+	CImg<int> coords( numVertices, 2 );
+
+	for( int i = 0; i <= stacks; ++i )
+	{
+		float phi = 3.14159265f * (float)i / (float)stacks;
+
+		for( int j = 0; j <= slices; ++j )
+		{
+			float theta = 2.0f * 3.14159265f * (float)j / (float)slices;
+			int v = i * ( slices + 1 ) + j;
+
+			SphereVertices( v, 0 ) = sinf( phi ) * sinf( theta );
+			SphereVertices( v, 1 ) = cosf( phi );
+			SphereVertices( v, 2 ) = sinf( phi ) * cosf( theta );
+			coords( v, 0 ) = ( j * ( textureSize - 1 ) ) / slices;
+			coords( v, 1 ) = ( i * ( textureSize - 1 ) ) / stacks;
+		}
+	}
+
+	SpherePrimitives.assign();
+
+	for( int i = 0; i < stacks; ++i )
+	{
+		for( int j = 0; j < slices; ++j )
+		{
+			unsigned int a = i * ( slices + 1 ) + j;
+			unsigned int b = a + ( slices + 1 );
+
+			CImg<unsigned int>::vector( a, b, b + 1 ).move_to( SpherePrimitives );
+			CImg<unsigned int>::vector( a, b + 1, a + 1 ).move_to( SpherePrimitives );
+		}
+	}
+
+	// sized up front: the colors of each layer share one texture image by pointer,
+	// which must never move once texturize_object3d() has set it up
+	LayerPrimitives.assign( numTextures, CImgList<unsigned int>() );
+	LayerColors.assign( numTextures, CImgList<unsigned char>() );
+
+	for( int layer = 0; layer < numTextures; ++layer )
+	{
+		CImg<unsigned char> texture;
+
+		try
+		{
+			texture.load( textureFiles[layer].c_str() );
+			texture.resize( textureSize, textureSize, 1, 3 );
+		}
+		catch( CImgException& )
+		{
+			std::cerr << "software renderer: could not load " << textureFiles[layer] << ", using gray" << std::endl;
+			texture.assign( textureSize, textureSize, 1, 3, 128 );
+		}
+
+		LayerPrimitives[layer] = SpherePrimitives;
+		LayerColors[layer].assign( SpherePrimitives.size() );
+		SphereVertices.texturize_object3d( LayerPrimitives[layer], LayerColors[layer], texture, coords );
+	}
+
+	Bodies.clear();
+}
+
+/*=================================================================================================
+  RENDER
+=================================================================================================*/
+
+// Same placement as instanced.vert: spin about the body's axis, move out to the orbit
+// distance, rotate along the orbit. Then the view matrix, and finally GL's camera space
+// (y up, looking down -z) is turned into CImg's (y down, looking down +z).
+void SoftwareRenderer::TransformBody( Body& body, const glm::mat4& m, float scaleX ) const
+{
+	const float toRadians = 3.14159265f / 180.0f;
+	float cs = cosf( body.Spin * toRadians ), ss = sinf( body.Spin * toRadians );
+	float co = cosf( body.Orbit * toRadians ), so = sinf( body.Orbit * toRadians );
+
+	int count = SphereVertices.width();
+	body.Vertices.assign( count, 3 );
+
+	for( int v = 0; v < count; ++v )
+	{
+		float x = SphereVertices( v, 0 ) * body.Radius;
+		float y = SphereVertices( v, 1 ) * body.Radius;
+		float z = SphereVertices( v, 2 ) * body.Radius;
+
+		float sx =  cs * x + ss * z + body.Distance;
+		float sz = -ss * x + cs * z;
+
+		float wx =  co * sx + so * sz;
+		float wz = -so * sx + co * sz;
+
+		body.Vertices( v, 0 ) =  ( m[0][0] * wx + m[1][0] * y + m[2][0] * wz + m[3][0] ) * scaleX;
+		body.Vertices( v, 1 ) = -( m[0][1] * wx + m[1][1] * y + m[2][1] * wz + m[3][1] );
+		body.Vertices( v, 2 ) = -( m[0][2] * wx + m[1][2] * y + m[2][2] * wz + m[3][2] );
+	}
+}
+
+// What draw_object3d() does before it rasterizes, done once per pose instead of in every
+// tile: the same projection, culling, depth order (nearest first, as with a z-buffer) and
+// flat shading, with the light at the camera. Z = -focale makes the projection divide by
+// the depth alone.
+void SoftwareRenderer::ProjectBody( Body& body, int width, int height, float focale ) const
+{
+	const float X = 0.5f * width, Y = 0.5f * height, Z = -focale;
+	const float zmin = 1.5f - focale;
+	const CImgList<unsigned int>& primitives = LayerPrimitives[body.Layer];
+	int count = body.Vertices.width();
+
+	body.Projections.assign( count, 2 );
+
+	for( int v = 0; v < count; ++v )
+	{
+		float z = body.Vertices( v, 2 ) + Z + focale;
+		body.Projections( v, 0 ) = X + focale * body.Vertices( v, 0 ) / z;
+		body.Projections( v, 1 ) = Y + focale * body.Vertices( v, 1 ) / z;
+	}
+
+	body.Visibles.assign( primitives.size() );
+	CImg<float> depths( primitives.size() );
+	unsigned int numVisible = 0;
+
+	for( unsigned int p = 0; p < primitives.size(); ++p )
+	{
+		const CImg<unsigned int>& primitive = primitives[p];
+		unsigned int i0 = primitive[0], i1 = primitive[1], i2 = primitive[2];
+		float x0 = body.Projections( i0, 0 ), y0 = body.Projections( i0, 1 ), z0 = Z + body.Vertices( i0, 2 );
+		float x1 = body.Projections( i1, 0 ), y1 = body.Projections( i1, 1 ), z1 = Z + body.Vertices( i1, 2 );
+		float x2 = body.Projections( i2, 0 ), y2 = body.Projections( i2, 1 ), z2 = Z + body.Vertices( i2, 2 );
+
+		if( std::max( std::max( x0, x1 ), x2 ) < 0 || std::min( std::min( x0, x1 ), x2 ) >= width ||
+			std::max( std::max( y0, y1 ), y2 ) < 0 || std::min( std::min( y0, y1 ), y2 ) >= height ||
+			z0 <= zmin || z1 <= zmin || z2 <= zmin )
+			continue;
+
+		// back faces wind the other way once projected
+		if( ( x1 - x0 ) * ( y2 - y0 ) - ( x2 - x0 ) * ( y1 - y0 ) >= 0 )
+			continue;
+
+		body.Visibles[numVisible] = p;
+		depths[numVisible] = ( z0 + z1 + z2 ) / 3;
+		++numVisible;
+	}
+
+	body.Order.assign();
+	body.Light.assign( numVisible );
+	body.Rows.assign( numVisible, 2 );
+
+	if( numVisible == 0 )
+		return;
+
+	CImg<float>( depths.data(), numVisible, 1, 1, 1, true ).sort( body.Order, true );
+
+	for( unsigned int l = 0; l < numVisible; ++l )
+	{
+		const CImg<unsigned int>& primitive = primitives[body.Visibles[body.Order[l]]];
+		unsigned int i0 = primitive[0], i1 = primitive[1], i2 = primitive[2];
+
+		// cosine between the face normal and the direction to a light far behind the camera
+		float dx1 = body.Vertices( i1, 0 ) - body.Vertices( i0, 0 ), dx2 = body.Vertices( i2, 0 ) - body.Vertices( i0, 0 );
+		float dy1 = body.Vertices( i1, 1 ) - body.Vertices( i0, 1 ), dy2 = body.Vertices( i2, 1 ) - body.Vertices( i0, 1 );
+		float dz1 = body.Vertices( i1, 2 ) - body.Vertices( i0, 2 ), dz2 = body.Vertices( i2, 2 ) - body.Vertices( i0, 2 );
+		float nx = dy1 * dz2 - dz1 * dy2, ny = dz1 * dx2 - dx1 * dz2, nz = dx1 * dy2 - dy1 * dx2;
+		body.Light[l] = std::min( fabsf( nz ) / ( 1e-5f + sqrtf( nx * nx + ny * ny + nz * nz ) ), 1.0f );
+
+		int r0 = cimg::uiround( body.Projections( i0, 1 ) );
+		int r1 = cimg::uiround( body.Projections( i1, 1 ) );
+		int r2 = cimg::uiround( body.Projections( i2, 1 ) );
+		body.Rows( l, 0 ) = std::min( std::min( r0, r1 ), r2 );
+		body.Rows( l, 1 ) = std::max( std::max( r0, r1 ), r2 );
+	}
+}
+
+// Draws into frame, which keeps its size; its width and height are the viewport
+void SoftwareRenderer::Render( const Scene& scene, const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, CImg<unsigned char>& frame )
+{
+	int width = frame.width();
+	int height = frame.height();
+
+	// CImg projects x and y with one focal length, so any difference between the
+	// projection's horizontal and vertical scale goes into the x coordinates
+	float focale = projectionMatrix[1][1] * 0.5f * height;
+	float scaleX = projectionMatrix[0][0] / projectionMatrix[1][1] * (float)width / (float)height;
+
+	bool cameraMoved = scaleX != CachedScaleX || focale != CachedFocale || width != CachedWidth || height != CachedHeight;
+	for( int c = 0; c < 4; ++c )
+		for( int r = 0; r < 4; ++r )
+			cameraMoved = cameraMoved || viewMatrix[c][r] != CachedView[c][r];
+
+	CachedView = viewMatrix;
+	CachedScaleX = scaleX;
+	CachedFocale = focale;
+	CachedWidth = width;
+	CachedHeight = height;
+
+	const OrbitState& state = scene.GetState();
+	int count = state.GetCount();
+	int numLayers = (int)LayerPrimitives.size();
+
+	if( (int)Bodies.size() != count )
+	{
+		Bodies.assign( count, Body() );
+		cameraMoved = true;
+	}
+
+	Frustum frustum;
+	frustum.Extract( projectionMatrix * viewMatrix );
+
+	std::vector<int> dirty;
+	Visible.clear();
+
+	for( int i = 0; i < count; ++i )
+	{
+		Body& body = Bodies[i];
+		float orbit, spin;
+		state.GetInterpolated( i, scene.GetAlpha(), orbit, spin );
+
+		if( cameraMoved == false && body.Vertices && orbit == body.Orbit && spin == body.Spin )
+		{
+			if( body.Visible )
+				Visible.push_back( i );
+			continue;
+		}
+
+		body.Orbit = orbit;
+		body.Spin = spin;
+		body.Radius = state.Radius[i];
+		body.Distance = state.Distance[i];
+		body.Layer = std::min( std::max( (int)state.Layer[i], 0 ), numLayers - 1 );
+
+		float angle = orbit * 3.14159265f / 180.0f;
+		float x =  body.Distance * cosf( angle );
+		float z = -body.Distance * sinf( angle );
+
+		// CImg does not clip against the near plane, so bodies reaching behind it are skipped
+		float depth = -( viewMatrix[0][2] * x + viewMatrix[2][2] * z + viewMatrix[3][2] );
+		body.Visible = numLayers > 0 && depth - body.Radius > 1e-3f && frustum.TestSphere( x, 0.0f, z, body.Radius );
+
+		if( body.Visible == false )
+		{
+			body.Vertices.assign();
+			continue;
+		}
+
+		float cx = ( viewMatrix[0][0] * x + viewMatrix[2][0] * z + viewMatrix[3][0] ) * scaleX;
+		float cy = -( viewMatrix[0][1] * x + viewMatrix[2][1] * z + viewMatrix[3][1] );
+		float extent = focale * body.Radius / ( depth - body.Radius ) * std::max( scaleX, 1.0f );
+
+		body.MinX = (int)floorf( 0.5f * width  + focale * cx / depth - extent );
+		body.MaxX = (int)ceilf ( 0.5f * width  + focale * cx / depth + extent );
+		body.MinY = (int)floorf( 0.5f * height + focale * cy / depth - extent );
+		body.MaxY = (int)ceilf ( 0.5f * height + focale * cy / depth + extent );
+
+		dirty.push_back( i );
+		Visible.push_back( i );
+	}
+
+	ThreadPool::RangeFunc transform = [this, &dirty, &viewMatrix, scaleX, width, height, focale]( int begin, int end ) {
+		for( int d = begin; d < end; ++d )
+		{
+			TransformBody( Bodies[dirty[d]], viewMatrix, scaleX );
+			ProjectBody( Bodies[dirty[d]], width, height, focale );
+		}
+	};
+
+	ThreadPool::RangeFunc tiles = [this, width, height, focale, &frame]( int begin, int end ) {
+		for( int tile = begin; tile < end; ++tile )
+			RenderTile( tile, width, height, focale, frame );
+	};
+
+	int numTiles = ( height + TileHeight - 1 ) / TileHeight;
+	NumTransformed = (int)dirty.size();
+
+	if( Pool != NULL )
+	{
+		Pool->Dispatch( (int)dirty.size(), 64, transform );
+		Pool->Wait();
+		Pool->Dispatch( numTiles, 1, tiles );
+		Pool->Wait();
+	}
+	else
+	{
+		transform( 0, (int)dirty.size() );
+		tiles( 0, numTiles );
+	}
+}
+
+// Each tile is drawn into its own small image and z-buffer, then copied into its rows of
+// the frame; no two tiles ever touch the same pixels. Only the triangles reaching the
+// tile's rows are rasterized, still nearest first, shifted up by the tile's first row.
+void SoftwareRenderer::RenderTile( int tile, int width, int height, float focale, CImg<unsigned char>& frame ) const
+{
+	int y0 = tile * TileHeight;
+	int y1 = std::min( height, y0 + TileHeight );
+
+	CImg<unsigned char> image( width, y1 - y0, 1, frame.spectrum(), 0 );
+	CImg<float> zbuffer( width, y1 - y0, 1, 1, 0.0f );
+	std::vector<unsigned int> order;
+
+	for( size_t v = 0; v < Visible.size(); ++v )
+	{
+		const Body& body = Bodies[Visible[v]];
+
+		if( body.MaxY < y0 || body.MinY >= y1 || body.MaxX < 0 || body.MinX >= width )
+			continue;
+
+		order.clear();
+		for( int l = 0; l < body.Rows.width(); ++l )
+			if( body.Rows( l, 1 ) >= y0 && body.Rows( l, 0 ) < y1 )
+				order.push_back( l );
+
+		if( order.empty() )
+			continue;
+
+		image._draw_object3d_primitives( NULL, zbuffer, 0.5f * width, 0.5f * height, -focale,
+			body.Vertices, LayerPrimitives[body.Layer], LayerColors[body.Layer], Opacities,
+			3, focale, focale, focale, 1.0f, 1.0f, body.Projections, body.Light, CImg<float>(),
+			body.Visibles, body.Order, order.data(), (unsigned int)order.size(), y0 );
+	}
+
+	frame.draw_image( 0, y0, image );
+}
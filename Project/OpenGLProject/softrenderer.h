@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "scene.h"
+#include "threadpool.h"
+#include "../CImg-3.3.6/CImg.h"
+
+// Draws the planet scene on the CPU with CImg's 3D rasterizer, without any OpenGL, for
+// deterministic output on machines with no GPU or display. Each texture layer gets its
+// own textured sphere, built once. Each body is transformed and projected once, and keeps
+// its visible triangles in depth order until its pose or the camera changes. Frames are
+// drawn in horizontal tiles, each with its own z-buffer, and the tiles are spread over the
+// thread pool; a tile rasterizes only the triangles that reach its rows. A tile's pixels
+// depend only on the bodies that overlap it, so the output is the same for any number of threads.
+class SoftwareRenderer
+{
+public:
+	SoftwareRenderer();
+
+public:
+	void Create( const std::string* textureFiles, int numTextures, int textureSize, int sphereSegments );
+	void SetThreadPool( ThreadPool* pool ) { Pool = pool; }
+	void SetTileHeight( int height ) { TileHeight = height > 0 ? height : 1; }
+	void Render( const Scene& scene, const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, cimg_library::CImg<unsigned char>& frame );
+
+public:
+	int GetNumTransformed() const { return NumTransformed; }
+
+private:
+	// Vertices of one body in CImg's camera space (x right, y down, z into the screen) and
+	// projected onto the frame, plus the screen rectangle its bounding sphere covers. Visibles
+	// lists the front-facing triangles that reach into the frame, and Order sorts them nearest
+	// first; Light and Rows hold the flat shading and the first and last frame rows of each
+	// triangle, in that order.
+	struct Body
+	{
+		float Orbit;
+		float Spin;
+		float Radius;
+		float Distance;
+		int Layer;
+		bool Visible;
+		int MinX, MinY, MaxX, MaxY;
+		cimg_library::CImg<float> Vertices;
+		cimg_library::CImg<float> Projections;
+		cimg_library::CImg<unsigned int> Visibles;
+		cimg_library::CImg<unsigned int> Order;
+		cimg_library::CImg<float> Light;
+		cimg_library::CImg<int> Rows;
+	};
+
+	void TransformBody( Body& body, const glm::mat4& viewMatrix, float scaleX ) const;
+	void ProjectBody( Body& body, int width, int height, float focale ) const;
+	void RenderTile( int tile, int width, int height, float focale, cimg_library::CImg<unsigned char>& frame ) const;
+
+	cimg_library::CImg<float> SphereVertices;
+	cimg_library::CImgList<unsigned int> SpherePrimitives;
+	std::vector< cimg_library::CImgList<unsigned int> > LayerPrimitives;
+	std::vector< cimg_library::CImgList<unsigned char> > LayerColors;
+	cimg_library::CImg<float> Opacities;
+
+	std::vector<Body> Bodies;
+	std::vector<int> Visible;
+	glm::mat4 CachedView;
+	float CachedScaleX;
+	float CachedFocale;
+	int CachedWidth, CachedHeight;
+	ThreadPool* Pool;
+	int TileHeight;
+	int NumTransformed;
+};
@@ -0,0 +1,425 @@
+#include "texturestreamer.h"
+#include "glstate.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include "../CImg-3.3.6/CImg.h"
+using namespace cimg_library;
+
+// Staged images start on this boundary, which keeps the copies into the buffer aligned
+static const GLsizeiptr StagingAlignment = 64;
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+TextureStreamer::TextureStreamer()
+{
+	Pool = NULL;
+	Pending = 0;
+	Buffer = 0;
+	Size = 0;
+	Mapped = NULL;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+TextureStreamer::~TextureStreamer()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+// pool decodes the files; give it workers of its own, since Wait() on a pool waits for
+// every job in it. Without a pool, files are decoded right away on the calling thread.
+void TextureStreamer::Create( ThreadPool* pool, int stagingBytes )
+{
+	Delete();
+
+	Pool = pool;
+	Size = stagingBytes / StagingAlignment * StagingAlignment;
+
+	glGenBuffers( 1, &Buffer );
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, Buffer );
+
+	if( GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage )
+	{
+		// mapped once for good; coherent, so plain writes reach the GPU without a flush
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_PIXEL_UNPACK_BUFFER, Size, NULL, flags );
+		Mapped = (unsigned char*)glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, Size, flags );
+	}
+	else
+		glBufferData( GL_PIXEL_UNPACK_BUFFER, Size, NULL, GL_STREAM_DRAW );
+
+	glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+// Waits for decodes still running, and drops everything not uploaded yet
+void TextureStreamer::Delete( void )
+{
+	if( Pool != NULL )
+		Pool->Wait();
+
+	{
+		std::lock_guard<std::mutex> lock( Mutex );
+		Ready.clear();
+	}
+	Pending = 0;
+
+	for( size_t i = 0; i < Regions.size(); ++i )
+		glDeleteSync( Regions[i].Fence );
+	Regions.clear();
+
+	if( Buffer != 0 )
+	{
+		if( Mapped != NULL )
+		{
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER, Buffer );
+			glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+		}
+
+		glDeleteBuffers( 1, &Buffer );
+	}
+
+	Pool = NULL;
+	Buffer = 0;
+	Size = 0;
+	Mapped = NULL;
+}
+
+/*=================================================================================================
+  REQUESTS
+=================================================================================================*/
+
+// A small placeholder, replaced by the image at its own size once it is loaded
+GLuint TextureStreamer::CreateTexture2D( const std::string& path )
+{
+	std::vector<unsigned char> placeholder = Placeholder( 16, 16 );
+
+	GLuint texture;
+	glGenTextures( 1, &texture );
+	GLState.BindTexture( 0, GL_TEXTURE_2D, texture );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, 16, 16, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder.data() );
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+
+	Request( texture, GL_TEXTURE_2D, path, DecodeRGB( GL_TEXTURE_2D, 0, 0, 0 ) );
+
+	return texture;
+}
+
+// The layers of an array share one size, so every image is resampled to width x height
+GLuint TextureStreamer::CreateTextureArray( const std::string* paths, int count, int width, int height )
+{
+	std::vector<unsigned char> placeholder = Placeholder( width, height );
+
+	GLuint texture;
+	glGenTextures( 1, &texture );
+	GLState.BindTexture( 0, GL_TEXTURE_2D_ARRAY, texture );
+	glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_RGB, width, height, count, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	for( int layer = 0; layer < count; ++layer )
+		glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, placeholder.data() );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+	for( int layer = 0; layer < count; ++layer )
+		Request( texture, GL_TEXTURE_2D_ARRAY, paths[layer], DecodeRGB( GL_TEXTURE_2D_ARRAY, layer, width, height ) );
+
+	return texture;
+}
+
+// target is what texture is bound to: GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_CUBE_MAP
+void TextureStreamer::Request( GLuint texture, GLenum target, const std::string& path, const DecodeFunc& decode )
+{
+	++Pending;
+
+	ThreadPool::RangeFunc work = [this, texture, target, path, decode]( int, int ) {
+		Job job;
+		job.Texture = texture;
+		job.Target = target;
+		job.Path = path;
+		job.Next = 0;
+
+		try
+		{
+			job.Failed = decode( path, job.Images ) == false;
+		}
+		catch( std::exception& )
+		{
+			job.Failed = true;
+		}
+
+		std::lock_guard<std::mutex> lock( Mutex );
+		Ready.push_back( std::move( job ) );
+	};
+
+	if( Pool != NULL )
+		Pool->Dispatch( 1, 1, work );
+	else
+		work( 0, 1 );
+}
+
+/*=================================================================================================
+  UPLOADS
+=================================================================================================*/
+
+void TextureStreamer::Update( int maxBytes )
+{
+	Process( maxBytes, false );
+}
+
+// For runs that must look the same every time, e.g. headless ones: nothing is drawn
+// with a placeholder that a slower machine would still show
+void TextureStreamer::Finish( void )
+{
+	while( Pending > 0 )
+	{
+		if( Pool != NULL )
+			Pool->Wait();
+
+		Process( LLONG_MAX, true );
+	}
+}
+
+// Uploads images in the order they were decoded until the budget is spent, always at
+// least one. Only this thread pops jobs, and a deque keeps references to its elements
+// valid while the workers push more, so the front job is used outside the lock.
+void TextureStreamer::Process( long long budget, bool wait )
+{
+	Retire();
+
+	bool first = true;
+
+	for( ;; )
+	{
+		Job* job;
+		{
+			std::lock_guard<std::mutex> lock( Mutex );
+			if( Ready.empty() )
+				return;
+			job = &Ready.front();
+		}
+
+		if( job->Failed )
+			std::cerr << "texture streamer: could not load " << job->Path << ", keeping the placeholder" << std::endl;
+
+		while( job->Failed == false && job->Next < job->Images.size() )
+		{
+			Image& image = job->Images[job->Next];
+			long long bytes = (long long)image.Pixels.size();
+
+			if( bytes > budget && first == false )
+				return;
+
+			// the staging buffer is still busy; next frame
+			if( Upload( *job, image, wait ) == false )
+				return;
+
+			budget -= bytes;
+			first = false;
+			std::vector<unsigned char>().swap( image.Pixels );
+			++job->Next;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( Mutex );
+			Ready.pop_front();
+		}
+		--Pending;
+	}
+}
+
+// Copies the image into the staging buffer and uploads it from there. An image larger
+// than the whole buffer is uploaded straight from memory instead.
+bool TextureStreamer::Upload( const Job& job, const Image& image, bool wait )
+{
+	GLsizeiptr bytes = (GLsizeiptr)image.Pixels.size();
+	GLsizeiptr staged = ( bytes + StagingAlignment - 1 ) / StagingAlignment * StagingAlignment;
+	GLintptr offset = 0;
+	const void* source = image.Pixels.data();
+
+	bool useBuffer = Buffer != 0 && staged <= Size;
+	if( useBuffer )
+	{
+		if( Allocate( staged, wait, offset ) == false )
+			return false;
+
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, Buffer );
+
+		if( Mapped != NULL )
+			memcpy( Mapped + offset, image.Pixels.data(), bytes );
+		else
+		{
+			// unsynchronized is safe, the fences keep this range free
+			void* range = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+			memcpy( range, image.Pixels.data(), bytes );
+			glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+		}
+
+		source = (const void*)(intptr_t)offset;
+	}
+
+	GLState.BindTexture( 0, job.Target, job.Texture );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+	if( image.Target == GL_TEXTURE_2D )
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, image.Width, image.Height, 0, GL_RGB, GL_UNSIGNED_BYTE, source );
+	else if( image.Target == GL_TEXTURE_2D_ARRAY )
+		glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, image.Layer, image.Width, image.Height, 1, GL_RGB, GL_UNSIGNED_BYTE, source );
+	else
+		glTexSubImage2D( image.Target, 0, 0, 0, image.Width, image.Height, GL_RGB, GL_UNSIGNED_BYTE, source );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	if( useBuffer )
+	{
+		// any other glTexImage call would read from the buffer while it is bound
+		glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+		Region region;
+		region.Begin = offset;
+		region.End = offset + staged;
+		region.Fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		Regions.push_back( region );
+	}
+
+	return true;
+}
+
+/*=================================================================================================
+  STAGING
+=================================================================================================*/
+
+// Regions are handed out in order around the ring, so the free space is what lies past
+// the newest region and before the oldest one
+bool TextureStreamer::Allocate( GLsizeiptr size, bool wait, GLintptr& offset )
+{
+	for( ;; )
+	{
+		Retire();
+
+		if( Regions.empty() )
+		{
+			offset = 0;
+			return true;
+		}
+
+		GLintptr oldest = Regions.front().Begin;
+		GLintptr newest = Regions.back().End;
+		bool wrapped = Regions.back().Begin < oldest;
+
+		if( wrapped == false && newest + size <= Size )
+		{
+			offset = newest;
+			return true;
+		}
+
+		if( wrapped == false && size <= oldest )
+		{
+			offset = 0;
+			return true;
+		}
+
+		if( wrapped && newest + size <= oldest )
+		{
+			offset = newest;
+			return true;
+		}
+
+		if( wait == false )
+			return false;
+
+		WaitOldest();
+	}
+}
+
+// Frees the regions whose uploads the GPU has finished, oldest first, without waiting
+void TextureStreamer::Retire( void )
+{
+	while( Regions.empty() == false )
+	{
+		GLenum status = glClientWaitSync( Regions.front().Fence, 0, 0 );
+		if( status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED )
+			return;
+
+		glDeleteSync( Regions.front().Fence );
+		Regions.pop_front();
+	}
+}
+
+void TextureStreamer::WaitOldest( void )
+{
+	GLenum status = GL_TIMEOUT_EXPIRED;
+	while( status == GL_TIMEOUT_EXPIRED )
+		status = glClientWaitSync( Regions.front().Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000 );
+
+	glDeleteSync( Regions.front().Fence );
+	Regions.pop_front();
+}
+
+/*=================================================================================================
+  DECODING
+=================================================================================================*/
+
+TextureStreamer::DecodeFunc TextureStreamer::DecodeRGB( GLenum target, int layer, int width, int height )
+{
+	return [target, layer, width, height]( const std::string& path, std::vector<Image>& images ) {
+		CImg<unsigned char> texture;
+		texture.load( path.c_str() );
+
+		if( width > 0 && height > 0 )
+			texture.resize( width, height, 1, 3 );
+		else
+			texture.resize( -100, -100, 1, 3 );
+
+		Image image;
+		image.Target = target;
+		image.Layer = layer;
+		image.Width = texture.width();
+		image.Height = texture.height();
+
+		image.Pixels.resize( 3 * image.Width * image.Height );
+		texture.interleave_rgb( image.Pixels.data() );
+
+		images.push_back( std::move( image ) );
+		return true;
+	};
+}
+
+// A 4 x 4 gray checkerboard at any size
+std::vector<unsigned char> TextureStreamer::Placeholder( int width, int height )
+{
+	std::vector<unsigned char> pixels( 3 * width * height );
+	int period = std::max( 1, std::min( width, height ) / 4 );
+
+	for( int y = 0; y < height; ++y )
+	{
+		for( int x = 0; x < width; ++x )
+		{
+			unsigned char gray = ( ( x / period + y / period ) % 2 ) ? 160 : 96;
+			unsigned char* pixel = &pixels[3 * ( y * width + x )];
+			pixel[0] = pixel[1] = pixel[2] = gray;
+		}
+	}
+
+	return pixels;
+}
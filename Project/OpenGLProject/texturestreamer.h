@@ -0,0 +1,96 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "threadpool.h"
+
+// Loads textures in the background. Files are decoded, resized and interleaved to RGB on
+// a thread pool; the GL thread later copies the pixels into a persistently mapped pixel
+// unpack buffer and uploads them from there, a budget of bytes per frame. The buffer is
+// used as a ring, each upload fenced, and a region is only rewritten once its fence has
+// signaled, which Update() checks without ever waiting. Textures are allocated up front
+// with a placeholder, so they can be drawn from right away; a file that cannot be
+// loaded keeps its placeholder.
+class TextureStreamer
+{
+public:
+	// RGB pixels for one level 0 image: a whole GL_TEXTURE_2D (which is resized to fit),
+	// a layer of a GL_TEXTURE_2D_ARRAY, or a GL_TEXTURE_CUBE_MAP_POSITIVE_X + i face
+	struct Image
+	{
+		GLenum Target;
+		int Layer;
+		int Width;
+		int Height;
+		std::vector<unsigned char> Pixels;
+	};
+
+	// Runs on a worker: reads path and fills in the images, returns false on failure
+	typedef std::function<bool( const std::string& path, std::vector<Image>& images )> DecodeFunc;
+
+	TextureStreamer();
+	~TextureStreamer();
+
+public:
+	void Create( ThreadPool* pool, int stagingBytes );
+	void Delete();
+
+	GLuint CreateTexture2D( const std::string& path );
+	GLuint CreateTextureArray( const std::string* paths, int count, int width, int height );
+	void Request( GLuint texture, GLenum target, const std::string& path, const DecodeFunc& decode );
+
+	// Uploads decoded images, about maxBytes of them; call once per frame on the GL thread
+	void Update( int maxBytes );
+	// Waits for every request and uploads it
+	void Finish();
+
+public:
+	int GetNumPending() const { return Pending; }
+	bool IsPersistent() const { return Mapped != NULL; }
+
+	// Decoders for the common cases: the file resized to width x height (or kept at its
+	// size when width is 0) as one image of target, at layer
+	static DecodeFunc DecodeRGB( GLenum target, int layer, int width, int height );
+	// Gray checkerboard shown until a texture arrives
+	static std::vector<unsigned char> Placeholder( int width, int height );
+
+private:
+	struct Job
+	{
+		GLuint Texture;
+		GLenum Target;
+		std::string Path;
+		bool Failed;
+		size_t Next; // first image not uploaded yet
+		std::vector<Image> Images;
+	};
+
+	struct Region
+	{
+		GLintptr Begin;
+		GLintptr End;
+		GLsync Fence;
+	};
+
+	void Process( long long budget, bool wait );
+	bool Upload( const Job& job, const Image& image, bool wait );
+	bool Allocate( GLsizeiptr size, bool wait, GLintptr& offset );
+	void Retire();
+	void WaitOldest();
+
+	ThreadPool* Pool;
+	std::mutex Mutex;
+	std::deque<Job> Ready; // decoded, guarded by Mutex
+	std::atomic<int> Pending;
+
+	GLuint Buffer;
+	GLsizeiptr Size;
+	unsigned char* Mapped; // NULL without GL_ARB_buffer_storage: then each upload maps its range
+	std::deque<Region> Regions;
+};
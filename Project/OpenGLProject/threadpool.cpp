@@ -0,0 +1,147 @@
+#include "threadpool.h"
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+ThreadPool::ThreadPool()
+{
+	Pending = 0;
+	Stopping = false;
+}
+
+ThreadPool::ThreadPool( int numThreads )
+{
+	Pending = 0;
+	Stopping = false;
+
+	Create( numThreads );
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+ThreadPool::~ThreadPool()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void ThreadPool::Create( int numThreads )
+{
+	Delete();
+
+	Stopping = false;
+
+	for( int i = 0; i < numThreads; ++i )
+		Workers.push_back( std::thread( &ThreadPool::WorkerLoop, this ) );
+}
+
+int ThreadPool::GetDefaultNumThreads( void )
+{
+	int hardware = (int)std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 0;
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+// Finishes the queued work, then stops and joins every worker
+void ThreadPool::Delete( void )
+{
+	if( Workers.empty() )
+		return;
+
+	Wait();
+
+	{
+		std::lock_guard<std::mutex> lock( Mutex );
+		Stopping = true;
+	}
+	TaskReady.notify_all();
+
+	for( size_t i = 0; i < Workers.size(); ++i )
+		Workers[i].join();
+
+	Workers.clear();
+}
+
+/*=================================================================================================
+  DISPATCH
+=================================================================================================*/
+
+// Splits [0, count) into ranges of about grain items. Without workers the job runs on
+// the calling thread before returning.
+void ThreadPool::Dispatch( int count, int grain, const RangeFunc& func )
+{
+	if( count <= 0 )
+		return;
+
+	if( Workers.empty() )
+	{
+		func( 0, count );
+		return;
+	}
+
+	if( grain < 1 )
+		grain = 1;
+
+	{
+		std::lock_guard<std::mutex> lock( Mutex );
+
+		for( int begin = 0; begin < count; begin += grain )
+		{
+			Task task;
+			task.Func = func;
+			task.Begin = begin;
+			task.End = begin + grain < count ? begin + grain : count;
+			Tasks.push_back( task );
+			++Pending;
+		}
+	}
+	TaskReady.notify_all();
+}
+
+void ThreadPool::Wait( void )
+{
+	if( Pending == 0 )
+		return;
+
+	std::unique_lock<std::mutex> lock( Mutex );
+	TasksDone.wait( lock, [this] { return Pending == 0; } );
+}
+
+/*=================================================================================================
+  WORKERS
+=================================================================================================*/
+
+void ThreadPool::WorkerLoop( void )
+{
+	for( ;; )
+	{
+		Task task;
+
+		{
+			std::unique_lock<std::mutex> lock( Mutex );
+			TaskReady.wait( lock, [this] { return Stopping || !Tasks.empty(); } );
+
+			if( Tasks.empty() )
+				return;
+
+			task = Tasks.front();
+			Tasks.pop_front();
+		}
+
+		task.Func( task.Begin, task.End );
+
+		// decrement under the lock so Wait() cannot miss the wake-up
+		std::lock_guard<std::mutex> lock( Mutex );
+		if( --Pending == 0 )
+			TasksDone.notify_all();
+	}
+}
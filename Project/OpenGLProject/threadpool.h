@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run ranges of a data-parallel job. Dispatch() only
+// queues work and returns, so the caller (the render thread) keeps going while the
+// workers run; Wait() blocks until everything dispatched so far has finished.
+class ThreadPool
+{
+public:
+	typedef std::function<void( int begin, int end )> RangeFunc;
+
+	ThreadPool();
+	explicit ThreadPool( int numThreads );
+	~ThreadPool();
+
+public:
+	void Create( int numThreads );
+	void Delete();
+	void Dispatch( int count, int grain, const RangeFunc& func );
+	void Wait();
+
+public:
+	int GetNumThreads() const { return (int)Workers.size(); }
+
+	// Worker count that leaves one hardware thread for the caller
+	static int GetDefaultNumThreads();
+
+private:
+	struct Task
+	{
+		RangeFunc Func;
+		int Begin;
+		int End;
+	};
+
+	void WorkerLoop();
+
+	std::vector<std::thread> Workers;
+	std::deque<Task> Tasks;
+	std::mutex Mutex;
+	std::condition_variable TaskReady;
+	std::condition_variable TasksDone;
+	std::atomic<int> Pending;
+	bool Stopping;
+};
@@ -0,0 +1,130 @@
+#include "uniformbuffer.h"
+#include <cstring>
+
+/*=================================================================================================
+  CONSTRUCTORS
+=================================================================================================*/
+
+UniformRing::UniformRing()
+{
+	Binding = 0;
+	Buffer = 0;
+	BlockSize = 0;
+	Stride = 0;
+	Current = -1;
+	Mapped = NULL;
+}
+
+/*=================================================================================================
+  DESTRUCTOR
+=================================================================================================*/
+
+UniformRing::~UniformRing()
+{
+	Delete();
+}
+
+/*=================================================================================================
+  CREATE
+=================================================================================================*/
+
+void UniformRing::Create( GLuint binding, GLsizeiptr blockSize, int numFrames )
+{
+	Delete();
+
+	GLint alignment = 256;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+
+	Binding = binding;
+	BlockSize = blockSize;
+	Stride = ( blockSize + alignment - 1 ) / alignment * alignment;
+	Fences.assign( numFrames, (GLsync)0 );
+
+	GLsizeiptr size = Stride * numFrames;
+
+	glGenBuffers( 1, &Buffer );
+	glBindBuffer( GL_UNIFORM_BUFFER, Buffer );
+
+	if( GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage )
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_UNIFORM_BUFFER, size, NULL, flags );
+		Mapped = (unsigned char*)glMapBufferRange( GL_UNIFORM_BUFFER, 0, size, flags );
+	}
+	else
+		glBufferData( GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW );
+
+	glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+}
+
+/*=================================================================================================
+  DELETE
+=================================================================================================*/
+
+void UniformRing::Delete( void )
+{
+	for( size_t i = 0; i < Fences.size(); ++i )
+	{
+		if( Fences[i] != 0 )
+			glDeleteSync( Fences[i] );
+	}
+	Fences.clear();
+
+	if( Buffer != 0 )
+	{
+		if( Mapped != NULL )
+		{
+			glBindBuffer( GL_UNIFORM_BUFFER, Buffer );
+			glUnmapBuffer( GL_UNIFORM_BUFFER );
+			glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+		}
+
+		glDeleteBuffers( 1, &Buffer );
+	}
+
+	Buffer = 0;
+	BlockSize = 0;
+	Stride = 0;
+	Current = -1;
+	Mapped = NULL;
+}
+
+/*=================================================================================================
+  UPDATE
+=================================================================================================*/
+
+void UniformRing::Update( const void* data )
+{
+	if( Buffer == 0 )
+		return;
+
+	// the last frame's draws are all queued by now
+	if( Current >= 0 )
+		Fences[Current] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	Current = ( Current + 1 ) % (int)Fences.size();
+
+	// only waits when the GPU is a whole ring of frames behind
+	if( Fences[Current] != 0 )
+	{
+		GLenum status = GL_TIMEOUT_EXPIRED;
+		while( status == GL_TIMEOUT_EXPIRED )
+			status = glClientWaitSync( Fences[Current], GL_SYNC_FLUSH_COMMANDS_BIT, 100000000 );
+
+		glDeleteSync( Fences[Current] );
+		Fences[Current] = 0;
+	}
+
+	GLintptr offset = Stride * Current;
+
+	if( Mapped != NULL )
+		memcpy( Mapped + offset, data, BlockSize );
+	else
+	{
+		glBindBuffer( GL_UNIFORM_BUFFER, Buffer );
+		glBufferSubData( GL_UNIFORM_BUFFER, offset, BlockSize, data );
+		glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+	}
+
+	glBindBufferRange( GL_UNIFORM_BUFFER, Binding, Buffer, offset, BlockSize );
+}
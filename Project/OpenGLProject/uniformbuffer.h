@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// One uniform block's worth of data, rewritten every frame and shared by every program
+// bound to the same binding point. The buffer holds a ring of copies, one per frame in
+// flight: Update() writes the next copy and binds it with glBindBufferRange(), so the
+// GPU can still be reading the copies of earlier frames. Each copy is fenced when the
+// next frame starts and only rewritten once its fence has signaled. With GL 4.4 or
+// GL_ARB_buffer_storage the buffer stays mapped; otherwise copies go in with glBufferSubData().
+class UniformRing
+{
+public:
+	UniformRing();
+	~UniformRing();
+
+public:
+	void Create( GLuint binding, GLsizeiptr blockSize, int numFrames );
+	void Delete();
+
+	// Once per frame, before the draws that read the block
+	void Update( const void* data );
+
+public:
+	GLuint GetBinding() const { return Binding; }
+	bool IsPersistent() const { return Mapped != NULL; }
+
+private:
+	GLuint Binding;
+	GLuint Buffer;
+	GLsizeiptr BlockSize;
+	GLsizeiptr Stride; // BlockSize rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	int Current;       // copy bound last, -1 before the first Update()
+	unsigned char* Mapped;
+	std::vector<GLsync> Fences; // one per copy, 0 when not in use
+};
+
+// Binding point of the FrameConstants block
+const GLuint FrameConstantsBinding = 0;
+
+// Mirrors the std140 FrameConstants block of the shaders: every member a mat4, so the
+// C++ and GLSL layouts agree without padding
+struct FrameConstants
+{
+	glm::mat4 ProjectionMatrix;     // scene camera
+	glm::mat4 ViewMatrix;
+	glm::mat4 AxisProjectionMatrix; // axis gizmo
+	glm::mat4 AxisViewMatrix;
+	glm::mat4 AxisModelMatrix;
+};